@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "Engine/DeveloperSettings.h"
+#include "LightweightProjectileSettings.generated.h"
+
+class UProjectileCatalog;
+
+/**
+ * Project-wide settings for the lightweight projectile pipeline
+ */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "Lightweight Projectiles"))
+class LYRAGAME_API ULightweightProjectileSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	// Projectile types which get their templates built at world start and a compact type id assigned
+	UPROPERTY(config, EditAnywhere, Category = "Catalog")
+	TSoftObjectPtr<UProjectileCatalog> ProjectileCatalog;
+
+	// Async loads every soft reference the catalog's projectile types use once the world begins play
+	UPROPERTY(config, EditAnywhere, Category = "Catalog")
+	bool bPreloadCatalogOnBeginPlay = true;
+
+	// Most lightweight projectiles alive at once, the lowest priority ones are destroyed past this. 0 for no limit
+	UPROPERTY(config, EditAnywhere, Category = "Budget", meta = (ClampMin = "0"))
+	int32 MaxLiveProjectiles = 0;
+
+	// Eviction score per second of age, highest scores are evicted first
+	UPROPERTY(config, EditAnywhere, Category = "Budget")
+	float EvictionAgeWeight = 1.f;
+
+	// Eviction score per metre from the nearest player
+	UPROPERTY(config, EditAnywhere, Category = "Budget")
+	float EvictionDistanceWeight = 0.1f;
+
+	// Flat eviction score for purely cosmetic projectiles
+	UPROPERTY(config, EditAnywhere, Category = "Budget")
+	float EvictionCosmeticBias = 10.f;
+
+	// Most hits applied on the game thread per frame, the rest carry over to following frames. 0 for no limit
+	UPROPERTY(config, EditAnywhere, Category = "Hit Apply", meta = (ClampMin = "0"))
+	int32 MaxHitsAppliedPerFrame = 0;
+
+	// Game thread time spent applying hits per frame before the rest carry over, at least one hit is always applied. 0 for no limit
+	UPROPERTY(config, EditAnywhere, Category = "Hit Apply", meta = (ClampMin = "0", Units = "ms"))
+	float HitApplyBudgetMs = 0.f;
+
+	// Carried over hits whose effect would take this attribute to or below LethalThreshold are applied first, e.g. health
+	UPROPERTY(config, EditAnywhere, Category = "Hit Apply")
+	FGameplayAttribute LethalCheckAttribute;
+
+	UPROPERTY(config, EditAnywhere, Category = "Hit Apply")
+	float LethalThreshold = 0.f;
+};
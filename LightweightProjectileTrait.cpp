@@ -2,19 +2,107 @@
 
 
 #include "Mass/LightweightProjectileTrait.h"
+#include "Curves/CurveFloat.h"
 #include "MassCommonFragments.h"
 #include "MassEntitySubsystem.h"
 #include "MassEntityTemplateRegistry.h"
 #include "MassMovementFragments.h"
+#include "Mass/ProjectileStats.h"
+
+namespace LightweightProjectileTrait
+{
+	// Reference drag coefficients by Mach number, coarse samples of the standard G1 and G7 tables
+	static const FVector2f G1DragPoints[] = {
+		{ 0.0f, 0.2629f }, { 0.5f, 0.2032f }, { 0.7f, 0.1952f }, { 0.8f, 0.2034f }, { 0.9f, 0.2546f },
+		{ 0.95f, 0.3090f }, { 1.0f, 0.4805f }, { 1.05f, 0.5427f }, { 1.1f, 0.5663f }, { 1.2f, 0.5880f },
+		{ 1.5f, 0.5722f }, { 2.0f, 0.5129f }, { 2.5f, 0.4585f }, { 3.0f, 0.4150f }, { 4.0f, 0.3580f }, { 5.0f, 0.3210f } };
+
+	static const FVector2f G7DragPoints[] = {
+		{ 0.0f, 0.1198f }, { 0.5f, 0.1197f }, { 0.7f, 0.1194f }, { 0.8f, 0.1210f }, { 0.9f, 0.1283f },
+		{ 0.95f, 0.1700f }, { 1.0f, 0.3803f }, { 1.05f, 0.4015f }, { 1.1f, 0.4043f }, { 1.2f, 0.3964f },
+		{ 1.5f, 0.3600f }, { 2.0f, 0.2980f }, { 2.5f, 0.2606f }, { 3.0f, 0.2278f }, { 4.0f, 0.1877f }, { 5.0f, 0.1618f } };
+
+	static constexpr float MaxTableMach = 5.f;
+
+	static float SamplePoints(TConstArrayView<FVector2f> points, float mach)
+	{
+		for (int32 idx = 1; idx < points.Num(); ++idx)
+		{
+			if (mach <= points[idx].X)
+			{
+				const float alpha = (mach - points[idx - 1].X) / (points[idx].X - points[idx - 1].X);
+				return FMath::Lerp(points[idx - 1].Y, points[idx].Y, alpha);
+			}
+		}
+		return points.Last().Y;
+	}
+
+	static void BuildMachDragTable(EProjectileDragModel model, const UCurveFloat* customCurve, FProjectileDragFragment& dragFragment)
+	{
+		dragFragment.MachDragTable.Reset();
+		if (model == EProjectileDragModel::Constant || (model == EProjectileDragModel::Custom && customCurve == nullptr))
+		{
+			return;
+		}
+
+		const int32 numSamples = FMath::CeilToInt32(MaxTableMach / dragFragment.MachTableStep) + 1;
+		dragFragment.MachDragTable.SetNumUninitialized(numSamples);
+		for (int32 idx = 0; idx < numSamples; ++idx)
+		{
+			const float mach = idx * dragFragment.MachTableStep;
+			switch (model)
+			{
+			case EProjectileDragModel::G1:
+				dragFragment.MachDragTable[idx] = SamplePoints(G1DragPoints, mach);
+				break;
+			case EProjectileDragModel::G7:
+				dragFragment.MachDragTable[idx] = SamplePoints(G7DragPoints, mach);
+				break;
+			default:
+				dragFragment.MachDragTable[idx] = customCurve->GetFloatValue(mach);
+				break;
+			}
+		}
+
+		// Normalise so DragCoefficient stays the subsonic drag designers tune against
+		const float baseDrag = dragFragment.MachDragTable[0];
+		if (baseDrag > UE_KINDA_SMALL_NUMBER)
+		{
+			for (float& drag : dragFragment.MachDragTable)
+			{
+				drag /= baseDrag;
+			}
+		}
+	}
+}
 
 void ULightweightProjectileTrait::BuildTemplate(FMassEntityTemplateBuildContext& buildContext, const UWorld& world) const
 {
 	UMassEntitySubsystem* entitySS = world.GetSubsystem<UMassEntitySubsystem>();
 	FMassEntityManager& entityManager = entitySS->GetMutableEntityManager();
 
-	buildContext.AddFragment<FTransformFragment>();
-	buildContext.AddFragment<FMassForceFragment>();
-	buildContext.AddFragment<FMassVelocityFragment>();
+	EProjectileStateLayout stateLayout = StateLayout;
+	if (bUsesForce && stateLayout != EProjectileStateLayout::Transform)
+	{
+		UE_LOG(LogLightweightProjectiles, Warning, TEXT("%s uses force, which compact state layouts don't store. Using the transform layout instead"), *GetPathName());
+		stateLayout = EProjectileStateLayout::Transform;
+	}
+
+	switch (stateLayout)
+	{
+	case EProjectileStateLayout::Compact:
+		buildContext.AddFragment<FProjectileStateFragment>();
+		break;
+	case EProjectileStateLayout::CompactFloat:
+		buildContext.AddFragment<FProjectileRelativeStateFragment>();
+		break;
+	default:
+		buildContext.AddFragment<FTransformFragment>();
+		buildContext.AddFragment<FMassForceFragment>();
+		buildContext.AddFragment<FMassVelocityFragment>();
+		break;
+	}
+	buildContext.AddChunkFragment<FProjectileSweepOrderChunkFragment>();
 
 	FConstSharedStruct archetypeDescFrag = entityManager.GetOrCreateConstSharedFragment<FProjectileArchetypeDescription>(ProjectileArchetypeDescription);
 	buildContext.AddConstSharedFragment(archetypeDescFrag);
@@ -24,7 +112,65 @@ void ULightweightProjectileTrait::BuildTemplate(FMassEntityTemplateBuildContext&
 	FConstSharedStruct damageFrag = entityManager.GetOrCreateConstSharedFragment<FGEDamageFragment>(damageFragment);
 	buildContext.AddConstSharedFragment(damageFrag);
 
+	switch (NetExecution)
+	{
+	case EProjectileNetExecution::ServerOnly:
+		buildContext.AddTag<FProjectileServerOnlyTag>();
+		break;
+	case EProjectileNetExecution::ClientsOnly:
+		buildContext.AddTag<FProjectileCosmeticTag>();
+		break;
+	default:
+		if (bClientConfirmedHits)
+		{
+			buildContext.AddTag<FProjectileClientConfirmedHitsTag>();
+		}
+		break;
+	}
+
+	// Hitscan hits go straight to the hit subsystem as single target damage from the server's own sweep
+	bool bHitscan = Hitscan.SpeedThreshold > 0.f;
+	if (bHitscan && AreaDamage.Radius > 0.f)
+	{
+		UE_LOG(LogLightweightProjectiles, Warning, TEXT("%s has area damage, which hitscan doesn't apply. Ignoring its hitscan settings"), *GetPathName());
+		bHitscan = false;
+	}
+	if (bHitscan && bClientConfirmedHits && NetExecution == EProjectileNetExecution::ServerAndClients)
+	{
+		UE_LOG(LogLightweightProjectiles, Warning, TEXT("%s uses client confirmed hits, which hitscan doesn't support. Ignoring its hitscan settings"), *GetPathName());
+		bHitscan = false;
+	}
+	if (bHitscan)
+	{
+		FConstSharedStruct hitscanFrag = entityManager.GetOrCreateConstSharedFragment<FProjectileHitscanFragment>(Hitscan);
+		buildContext.AddConstSharedFragment(hitscanFrag);
+	}
+
+	buildContext.AddFragment<FProjectileSpawnTimeFragment>();
+	if (Budget.MaxAlive > 0)
+	{
+		FConstSharedStruct budgetFrag = entityManager.GetOrCreateConstSharedFragment<FProjectileBudgetFragment>(Budget);
+		buildContext.AddConstSharedFragment(budgetFrag);
+	}
+
+	if (Streaming.UnloadedRegionPolicy != EProjectileUnloadedRegionPolicy::Simulate)
+	{
+		FConstSharedStruct streamingFrag = entityManager.GetOrCreateConstSharedFragment<FProjectileStreamingPolicyFragment>(Streaming);
+		buildContext.AddConstSharedFragment(streamingFrag);
+		if (Streaming.UnloadedRegionPolicy == EProjectileUnloadedRegionPolicy::Sleep)
+		{
+			buildContext.AddFragment<FProjectileDormantTimeFragment>();
+		}
+	}
+
+	if (AreaDamage.Radius > 0.f)
+	{
+		FConstSharedStruct areaDamageFrag = entityManager.GetOrCreateConstSharedFragment<FProjectileAreaDamageFragment>(AreaDamage);
+		buildContext.AddConstSharedFragment(areaDamageFrag);
+	}
+
 	buildContext.AddFragment<FInstigatorOwnerFragment>();
+	buildContext.AddFragment<FProjectileTypeIdFragment>();
 	buildContext.AddFragment<FHitInfoFragment>();
 	buildContext.AddFragment<FCollisionIgnoredFragment>();
 
@@ -32,4 +178,24 @@ void ULightweightProjectileTrait::BuildTemplate(FMassEntityTemplateBuildContext&
 	gravityScaleFragment.GravityScale = GravityScale;
 	FConstSharedStruct gravityScaleFrag = entityManager.GetOrCreateConstSharedFragment<FGravityScaleFragment>(gravityScaleFragment);
 	buildContext.AddConstSharedFragment(gravityScaleFrag);
+
+	FProjectileDragFragment dragFragment;
+	if (MakeDragFragment(dragFragment))
+	{
+		FConstSharedStruct dragFrag = entityManager.GetOrCreateConstSharedFragment<FProjectileDragFragment>(dragFragment);
+		buildContext.AddConstSharedFragment(dragFrag);
+	}
+}
+
+bool ULightweightProjectileTrait::MakeDragFragment(FProjectileDragFragment& outDragFragment) const
+{
+	if (DragCoefficient <= 0.f && MaxSpeed <= 0.f)
+	{
+		return false;
+	}
+
+	outDragFragment.DragCoefficient = DragCoefficient;
+	outDragFragment.MaxSpeed = MaxSpeed;
+	LightweightProjectileTrait::BuildMachDragTable(DragModel, CustomDragCurve, outDragFragment);
+	return true;
 }
@@ -6,6 +6,8 @@
 #include "Mass/ProjectileFragments.h"
 #include "LightweightProjectileTrait.generated.h"
 
+class UCurveFloat;
+
 /**
  * 
  */
@@ -17,6 +19,9 @@ class LYRAGAME_API ULightweightProjectileTrait : public UMassEntityTraitBase
 public:
 	virtual void BuildTemplate(FMassEntityTemplateBuildContext& buildContext, const UWorld& world) const override;
 
+	// Same drag the template gets, false when the projectile has none
+	bool MakeDragFragment(FProjectileDragFragment& outDragFragment) const;
+
 	UPROPERTY(EditAnywhere, meta = (ShowOnlyInnerProperties))
 	FProjectileArchetypeDescription ProjectileArchetypeDescription;
 
@@ -26,6 +31,51 @@ public:
 	UPROPERTY(EditAnywhere)
 	float GravityScale = 1.f;
 
+	// Compact layouts cut the per-entity simulation state to under a third, but generic Mass processors
+	// that expect FTransformFragment won't see these projectiles. Use UMassHelpers to read or write their transform
+	UPROPERTY(EditAnywhere)
+	EProjectileStateLayout StateLayout = EProjectileStateLayout::Transform;
+
+	// Set when gameplay drives this projectile through UMassHelpers::SetEntityForce. Compact layouts have no
+	// force, so this keeps the transform layout whatever StateLayout says
+	UPROPERTY(EditAnywhere)
+	bool bUsesForce = false;
+
+	// Which net roles spawn and simulate this projectile
+	UPROPERTY(EditAnywhere)
+	EProjectileNetExecution NetExecution = EProjectileNetExecution::ServerAndClients;
+
+	// Owning clients report hits to the server in batches instead of the server resolving them itself
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "NetExecution == EProjectileNetExecution::ServerAndClients"))
+	bool bClientConfirmedHits = false;
+
+	// Deceleration per unit speed squared, 0 disables drag
+	UPROPERTY(EditAnywhere, Category = "Drag")
+	float DragCoefficient = 0.f;
+
+	// 0 for no limit
+	UPROPERTY(EditAnywhere, Category = "Drag")
+	float MaxSpeed = 0.f;
+
+	UPROPERTY(EditAnywhere, Category = "Drag", meta = (EditCondition = "DragCoefficient > 0"))
+	EProjectileDragModel DragModel = EProjectileDragModel::Constant;
+
+	// Drag scale keyed on Mach number, baked into a lookup table when the template is built
+	UPROPERTY(EditAnywhere, Category = "Drag", meta = (EditCondition = "DragModel == EProjectileDragModel::Custom"))
+	TObjectPtr<UCurveFloat> CustomDragCurve;
+
+	UPROPERTY(EditAnywhere, Category = "Hitscan", meta = (ShowOnlyInnerProperties))
+	FProjectileHitscanFragment Hitscan;
+
+	UPROPERTY(EditAnywhere, Category = "Budget", meta = (ShowOnlyInnerProperties))
+	FProjectileBudgetFragment Budget;
+
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ShowOnlyInnerProperties))
+	FProjectileStreamingPolicyFragment Streaming;
+
+	UPROPERTY(EditAnywhere, Category = "Area Damage", meta = (ShowOnlyInnerProperties))
+	FProjectileAreaDamageFragment AreaDamage;
+
 	// TODO: Consider how to handle switching between a single-hit projectile and once that handles shot penetration with multi sweeps
 
 };
@@ -2,13 +2,26 @@
 
 
 #include "Mass/MassHelpers.h"
+#include "Algo/StableSort.h"
 #include "Algo/Transform.h"
 #include "MassCommonFragments.h"
 #include "MassEntityConfigAsset.h"
 #include "MassEntitySubsystem.h"
 #include "MassSpawnerSubsystem.h"
 #include "MassMovementFragments.h"
+#include "GameplayEffect.h"
+#include "Mass/ProjectileCatalogSubsystem.h"
 #include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileHitConfirmation.h"
+#include "Mass/ProjectileHitscanSubsystem.h"
+#include "Mass/ProjectileSpawnRecorder.h"
+#include "Mass/ProjectileTrajectorySubsystem.h"
+
+namespace ProjectileHitscan
+{
+	static bool bSpawnTracers = true;
+	static FAutoConsoleVariableRef CVarSpawnTracers(TEXT("Projectiles.Hitscan.Tracers"), bSpawnTracers, TEXT("Spawn the TracerConfig entity for projectiles resolved at spawn"));
+}
 
 namespace Algo {
 	static bool IsValid(const UObject* test)
@@ -48,7 +61,22 @@ FMassEntityViewWrapper UMassHelpers::SpawnEntityFromEntityConfig(const UWorld* w
 		return outView;
 	}
 
+	// Prefer the prebuilt template if this config is in the projectile catalog
+	if (const UProjectileCatalogSubsystem* catalogSS = world->GetSubsystem<UProjectileCatalogSubsystem>())
+	{
+		const uint16 typeId = catalogSS->FindTypeId(massEntityConfig);
+		if (typeId != UProjectileCatalogSubsystem::InvalidTypeId)
+		{
+			return SpawnEntityFromTypeId(world, typeId);
+		}
+	}
+
 	const FMassEntityTemplate& entityTemplate = massEntityConfig->GetConfig().GetOrCreateEntityTemplate(*world);
+	if (!UProjectileCatalogSubsystem::ShouldSpawnInWorld(*world, entityTemplate))
+	{
+		return outView;
+	}
+
 	UMassSpawnerSubsystem* spawnerSS = world->GetSubsystem<UMassSpawnerSubsystem>();
 	UMassEntitySubsystem* entitySS = world->GetSubsystem<UMassEntitySubsystem>();
 	FMassEntityManager& entityManager = entitySS->GetMutableEntityManager();
@@ -62,9 +90,297 @@ FMassEntityViewWrapper UMassHelpers::SpawnEntityFromEntityConfig(const UWorld* w
 	}
 
 	outView = FMassEntityViewWrapper(entityManager, entities[0]);
+	InitSpawnedEntity(*world, outView.EntityView, UProjectileCatalogSubsystem::InvalidTypeId);
+	return outView;
+}
+
+/*static*/ FMassEntityViewWrapper UMassHelpers::BP_SpawnProjectile(const UObject* worldContextObject, const FProjectileSpawnParams& spawnParams, EMassHelpersReturnSuccess& returnBranch)
+{
+	FMassEntityViewWrapper outView;
+	returnBranch = EMassHelpersReturnSuccess::Failure;
+
+	const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (!IsValid(world))
+	{
+		return outView;
+	}
+
+	bool bHitscan = false;
+	outView = SpawnProjectile(world, spawnParams, &bHitscan);
+	if (outView.EntityView.IsSet() || bHitscan)
+	{
+		returnBranch = EMassHelpersReturnSuccess::Success;
+	}
+	return outView;
+}
+
+FMassEntityViewWrapper UMassHelpers::SpawnEntityFromTypeId(const UWorld* world, uint16 typeId)
+{
+	FMassEntityViewWrapper outView = SpawnEntityFromTemplateInternal(world, typeId);
+	if (outView.EntityView.IsSet())
+	{
+		// Caller fills in the initial state after this returns, so snapshot it at the end of the frame
+		if (UProjectileSpawnRecorderSubsystem* recorderSS = world->GetSubsystem<UProjectileSpawnRecorderSubsystem>())
+		{
+			recorderSS->RecordSpawnDeferred(outView.EntityView.GetEntity(), typeId);
+		}
+	}
+	return outView;
+}
+
+FMassEntityViewWrapper UMassHelpers::SpawnProjectile(const UWorld* world, const FProjectileSpawnParams& spawnParams, bool* bOutWasHitscan)
+{
+	if (bOutWasHitscan)
+	{
+		*bOutWasHitscan = false;
+	}
+	if (spawnParams.TypeId < 0 || spawnParams.TypeId >= UProjectileCatalogSubsystem::InvalidTypeId)
+	{
+		return FMassEntityViewWrapper();
+	}
+
+	FMassEntityViewWrapper outView;
+	if (const FProjectileHitscanFragment* hitscan = ResolveHitscan(world, spawnParams))
+	{
+		if (bOutWasHitscan)
+		{
+			*bOutWasHitscan = true;
+		}
+		if (hitscan->TracerConfig && ProjectileHitscan::bSpawnTracers)
+		{
+			// Catalogued tracers skip SpawnEntityFromTypeId, the record below already covers them
+			const uint16 tracerTypeId = world->GetSubsystem<UProjectileCatalogSubsystem>()->FindTypeId(hitscan->TracerConfig);
+			outView = tracerTypeId != UProjectileCatalogSubsystem::InvalidTypeId
+				? SpawnEntityFromTemplateInternal(world, tracerTypeId)
+				: SpawnEntityFromEntityConfig(world, hitscan->TracerConfig);
+		}
+		if (UProjectileSpawnRecorderSubsystem* recorderSS = world->GetSubsystem<UProjectileSpawnRecorderSubsystem>())
+		{
+			recorderSS->RecordSpawn(spawnParams);
+		}
+	}
+	else
+	{
+		outView = SpawnEntityFromTemplateInternal(world, static_cast<uint16>(spawnParams.TypeId));
+	}
+	if (!outView.EntityView.IsSet())
+	{
+		return outView;
+	}
+
+	InitProjectileState(*world, outView.EntityView, spawnParams);
+
+	if (bOutWasHitscan && *bOutWasHitscan)
+	{
+		// Tracer was recorded as the projectile it stands in for
+		return outView;
+	}
+
+	if (UProjectileSpawnRecorderSubsystem* recorderSS = world->GetSubsystem<UProjectileSpawnRecorderSubsystem>())
+	{
+		recorderSS->RecordSpawn(spawnParams);
+	}
+
+	return outView;
+}
+
+int32 UMassHelpers::SpawnProjectileBatch(const UWorld* world, TConstArrayView<FProjectileSpawnParams> spawnParams)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_MassHelpers_SpawnProjectileBatch);
+
+	const UProjectileCatalogSubsystem* catalogSS = world->GetSubsystem<UProjectileCatalogSubsystem>();
+	UMassSpawnerSubsystem* spawnerSS = world->GetSubsystem<UMassSpawnerSubsystem>();
+	UMassEntitySubsystem* entitySS = world->GetSubsystem<UMassEntitySubsystem>();
+	if (catalogSS == nullptr || spawnerSS == nullptr || entitySS == nullptr)
+	{
+		return 0;
+	}
+	FMassEntityManager& entityManager = entitySS->GetMutableEntityManager();
+	UProjectileSpawnRecorderSubsystem* recorderSS = world->GetSubsystem<UProjectileSpawnRecorderSubsystem>();
+
+	// Group by type so each archetype is only touched once
+	TArray<int32, TInlineAllocator<64>> order;
+	order.Reserve(spawnParams.Num());
+	for (int32 idx = 0; idx < spawnParams.Num(); ++idx)
+	{
+		if (spawnParams[idx].TypeId >= 0 && spawnParams[idx].TypeId < UProjectileCatalogSubsystem::InvalidTypeId)
+		{
+			order.Add(idx);
+		}
+	}
+	Algo::StableSortBy(order, [&spawnParams](int32 idx) { return spawnParams[idx].TypeId; });
+
+	int32 numSpawned = 0;
+	TArray<FMassEntityHandle> entities;
+	for (int32 runStart = 0; runStart < order.Num();)
+	{
+		const int32 typeIdInt = spawnParams[order[runStart]].TypeId;
+		int32 runEnd = runStart + 1;
+		while (runEnd < order.Num() && spawnParams[order[runEnd]].TypeId == typeIdInt)
+		{
+			++runEnd;
+		}
+		const TConstArrayView<int32> run = MakeArrayView(order).Slice(runStart, runEnd - runStart);
+		runStart = runEnd;
+
+		const uint16 typeId = static_cast<uint16>(typeIdInt);
+		const FMassEntityTemplate* entityTemplate = catalogSS->GetTemplate(typeId);
+		if (entityTemplate == nullptr || !catalogSS->IsTypeSpawnable(typeId))
+		{
+			continue;
+		}
+
+		// Hitscan launches mostly never become entities, not worth batching
+		if (catalogSS->GetConstSharedFragment<FProjectileHitscanFragment>(typeId) != nullptr)
+		{
+			for (const int32 idx : run)
+			{
+				bool bHitscan = false;
+				numSpawned += (SpawnProjectile(world, spawnParams[idx], &bHitscan).EntityView.IsSet() || bHitscan) ? 1 : 0;
+			}
+			continue;
+		}
+
+		entities.Reset();
+		spawnerSS->SpawnEntities(*entityTemplate, run.Num(), entities);
+		if (!ensure(entities.Num() == run.Num()))
+		{
+			continue;
+		}
+
+		for (int32 runIdx = 0; runIdx < run.Num(); ++runIdx)
+		{
+			const FProjectileSpawnParams& params = spawnParams[run[runIdx]];
+			const FMassEntityView view(entityManager, entities[runIdx]);
+			InitSpawnedEntity(*world, view, typeId);
+			InitProjectileState(*world, view, params);
+			if (recorderSS)
+			{
+				recorderSS->RecordSpawn(params);
+			}
+		}
+		numSpawned += run.Num();
+	}
+	return numSpawned;
+}
+
+void UMassHelpers::InitSpawnedEntity(const UWorld& world, const FMassEntityView& view, uint16 typeId)
+{
+	if (FProjectileTypeIdFragment* typeIdFragment = view.GetFragmentDataPtr<FProjectileTypeIdFragment>())
+	{
+		typeIdFragment->TypeId = typeId;
+	}
+	if (FProjectileSpawnTimeFragment* spawnTime = view.GetFragmentDataPtr<FProjectileSpawnTimeFragment>())
+	{
+		spawnTime->SpawnTime = world.GetTimeSeconds();
+	}
+}
+
+void UMassHelpers::InitProjectileState(const UWorld& world, const FMassEntityView& view, const FProjectileSpawnParams& spawnParams)
+{
+	SetProjectileTransform(view, spawnParams.Transform);
+	SetProjectileVelocity(view, spawnParams.Velocity);
+	SetInstigatorOwner(world, view, spawnParams.Instigator, spawnParams.Owner);
+	if (FCollisionIgnoredFragment* collisionIgnored = view.GetFragmentDataPtr<FCollisionIgnoredFragment>())
+	{
+		collisionIgnored->IgnoredActors.Empty(spawnParams.IgnoredActors.Num());
+		Algo::TransformIf(spawnParams.IgnoredActors, collisionIgnored->IgnoredActors, &Algo::IsValid, FIdentityFunctor());
+	}
+}
+
+const FProjectileHitscanFragment* UMassHelpers::ResolveHitscan(const UWorld* world, const FProjectileSpawnParams& spawnParams)
+{
+	const uint16 typeId = static_cast<uint16>(spawnParams.TypeId);
+	const UProjectileCatalogSubsystem* catalogSS = world->GetSubsystem<UProjectileCatalogSubsystem>();
+	const FProjectileHitscanFragment* hitscan = catalogSS ? catalogSS->GetConstSharedFragment<FProjectileHitscanFragment>(typeId) : nullptr;
+	if (hitscan == nullptr || !catalogSS->IsTypeSpawnable(typeId) || spawnParams.Velocity.SizeSquared() < FMath::Square(hitscan->SpeedThreshold))
+	{
+		return nullptr;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_MassHelpers_ResolveHitscan);
+
+	const FProjectileArchetypeDescription* archetypeDescription = catalogSS->GetConstSharedFragment<FProjectileArchetypeDescription>(typeId);
+	const FGravityScaleFragment* gravityScale = catalogSS->GetConstSharedFragment<FGravityScaleFragment>(typeId);
+	const FProjectileDragFragment* drag = catalogSS->GetConstSharedFragment<FProjectileDragFragment>(typeId);
+	if (!ensure(archetypeDescription))
+	{
+		return nullptr;
+	}
+
+	FCollisionQueryParams queryParams(SCENE_QUERY_STAT(ProjectileHitscan), false);
+	queryParams.bReturnPhysicalMaterial = true;
+	for (AActor* actor : spawnParams.IgnoredActors)
+	{
+		if (IsValid(actor))
+		{
+			queryParams.AddIgnoredActor(actor);
+		}
+	}
+
+	const FVector gravity(0.f, 0.f, world->GetGravityZ() * (gravityScale ? gravityScale->GravityScale : 1.f));
+
+	FProjectilePredictedPath path;
+	UProjectileTrajectorySubsystem::PredictPath(*world, *archetypeDescription, queryParams, gravity, drag, { spawnParams.Transform.GetLocation(), spawnParams.Velocity },
+		hitscan->MaxFlightTime, hitscan->ArcStepTime, false, path);
+
+	// Clients only get the tracer, the server resolves damage from its own sweep
+	if (path.bHit && world->GetNetMode() != NM_Client)
+	{
+		const FGEDamageFragment* damageFrag = catalogSS->GetConstSharedFragment<FGEDamageFragment>(typeId);
+		TSubclassOf<UGameplayEffect> damageEffect = damageFrag ? damageFrag->DamageEffect.Get() : nullptr;
+		if (UProjectileHitscanSubsystem* hitscanSS = world->GetSubsystem<UProjectileHitscanSubsystem>())
+		{
+			hitscanSS->ScheduleHit(world->GetTimeSeconds() + path.FlightTime, path.Hit, spawnParams.Instigator, spawnParams.Owner, damageEffect.GetDefaultObject());
+		}
+	}
+
+	return hitscan;
+}
+
+FMassEntityViewWrapper UMassHelpers::SpawnEntityFromTemplateInternal(const UWorld* world, uint16 typeId)
+{
+	FMassEntityViewWrapper outView;
+
+	const UProjectileCatalogSubsystem* catalogSS = world->GetSubsystem<UProjectileCatalogSubsystem>();
+	const FMassEntityTemplate* entityTemplate = catalogSS ? catalogSS->GetTemplate(typeId) : nullptr;
+	if (entityTemplate == nullptr || !catalogSS->IsTypeSpawnable(typeId))
+	{
+		return outView;
+	}
+
+	UMassSpawnerSubsystem* spawnerSS = world->GetSubsystem<UMassSpawnerSubsystem>();
+	UMassEntitySubsystem* entitySS = world->GetSubsystem<UMassEntitySubsystem>();
+	FMassEntityManager& entityManager = entitySS->GetMutableEntityManager();
+
+	TArray<FMassEntityHandle> entities;
+	spawnerSS->SpawnEntities(*entityTemplate, 1, entities);
+	if (!ensure(entities.Num() != 0))
+	{
+		return outView;
+	}
+
+	outView = FMassEntityViewWrapper(entityManager, entities[0]);
+	InitSpawnedEntity(*world, outView.EntityView, typeId);
 	return outView;
 }
 
+int32 UMassHelpers::GetProjectileTypeId(const UObject* worldContextObject, UMassEntityConfigAsset* massEntityConfig)
+{
+	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
+	{
+		if (const UProjectileCatalogSubsystem* catalogSS = world->GetSubsystem<UProjectileCatalogSubsystem>())
+		{
+			const uint16 typeId = catalogSS->FindTypeId(massEntityConfig);
+			if (typeId != UProjectileCatalogSubsystem::InvalidTypeId)
+			{
+				return typeId;
+			}
+		}
+	}
+	return INDEX_NONE;
+}
+
 void UMassHelpers::DestroyEntity_View(const UObject* worldContextObject, FMassEntityViewWrapper entity)
 {
 	DestroyEntity_Handle(worldContextObject, entity.EntityView.GetEntity());
@@ -153,6 +469,90 @@ bool UMassHelpers::IsEntityValid_Handle(const UObject* worldContextObject, FMass
 	return false;
 }
 
+bool UMassHelpers::SetProjectileTransform(const FMassEntityView& view, const FTransform& transform)
+{
+	if (FTransformFragment* transformFragment = view.GetFragmentDataPtr<FTransformFragment>())
+	{
+		transformFragment->SetTransform(transform);
+		return true;
+	}
+	if (FProjectileStateFragment* state = view.GetFragmentDataPtr<FProjectileStateFragment>())
+	{
+		state->SetFromTransform(transform);
+		return true;
+	}
+	if (FProjectileRelativeStateFragment* state = view.GetFragmentDataPtr<FProjectileRelativeStateFragment>())
+	{
+		state->SetFromTransform(transform);
+		return true;
+	}
+	return false;
+}
+
+bool UMassHelpers::GetProjectileTransform(const FMassEntityView& view, FTransform& outTransform)
+{
+	if (const FTransformFragment* transformFragment = view.GetFragmentDataPtr<FTransformFragment>())
+	{
+		outTransform = transformFragment->GetTransform();
+		return true;
+	}
+
+	// Compact layouts don't store a rotation when it just follows velocity
+	const FProjectileArchetypeDescription* archetypeDescription = view.GetConstSharedFragmentDataPtr<FProjectileArchetypeDescription>();
+	const bool bRotationFollowsVelocity = archetypeDescription && archetypeDescription->bRotationFollowsVelocity;
+	if (const FProjectileStateFragment* state = view.GetFragmentDataPtr<FProjectileStateFragment>())
+	{
+		outTransform = state->ToTransform(bRotationFollowsVelocity);
+		return true;
+	}
+	if (const FProjectileRelativeStateFragment* state = view.GetFragmentDataPtr<FProjectileRelativeStateFragment>())
+	{
+		outTransform = state->ToTransform(bRotationFollowsVelocity);
+		return true;
+	}
+	return false;
+}
+
+bool UMassHelpers::SetProjectileVelocity(const FMassEntityView& view, const FVector& velocity)
+{
+	if (FMassVelocityFragment* velocityFragment = view.GetFragmentDataPtr<FMassVelocityFragment>())
+	{
+		velocityFragment->Value = velocity;
+		return true;
+	}
+	if (FProjectileStateFragment* state = view.GetFragmentDataPtr<FProjectileStateFragment>())
+	{
+		state->SetVelocity(velocity);
+		return true;
+	}
+	if (FProjectileRelativeStateFragment* state = view.GetFragmentDataPtr<FProjectileRelativeStateFragment>())
+	{
+		state->SetVelocity(velocity);
+		return true;
+	}
+	return false;
+}
+
+bool UMassHelpers::GetProjectileVelocity(const FMassEntityView& view, FVector& outVelocity)
+{
+	if (const FMassVelocityFragment* velocityFragment = view.GetFragmentDataPtr<FMassVelocityFragment>())
+	{
+		outVelocity = velocityFragment->Value;
+		return true;
+	}
+	if (const FProjectileStateFragment* state = view.GetFragmentDataPtr<FProjectileStateFragment>())
+	{
+		outVelocity = state->GetVelocity();
+		return true;
+	}
+	if (const FProjectileRelativeStateFragment* state = view.GetFragmentDataPtr<FProjectileRelativeStateFragment>())
+	{
+		outVelocity = state->GetVelocity();
+		return true;
+	}
+	return false;
+}
+
 void UMassHelpers::SetEntityTransform_View(const UObject* worldContextObject, FMassEntityViewWrapper entity, const FTransform& transform)
 {
 	if (!IsEntityValid_View(worldContextObject, entity))
@@ -160,10 +560,7 @@ void UMassHelpers::SetEntityTransform_View(const UObject* worldContextObject, FM
 		return;
 	}
 
-	if (FTransformFragment* transformFragment = entity.EntityView.GetFragmentDataPtr<FTransformFragment>())
-	{
-		transformFragment->SetTransform(transform);
-	}
+	SetProjectileTransform(entity.EntityView, transform);
 }
 
 void UMassHelpers::SetEntityTransform_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity, const FTransform& transform)
@@ -176,10 +573,7 @@ void UMassHelpers::SetEntityTransform_Handle(const UObject* worldContextObject,
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (FTransformFragment* transformFragment = entityManager.GetFragmentDataPtr<FTransformFragment>(entity.Handle))
-		{
-			transformFragment->SetTransform(transform);
-		}
+		SetProjectileTransform(FMassEntityView(entityManager, entity.Handle), transform);
 	}
 }
 
@@ -190,10 +584,7 @@ void UMassHelpers::GetEntityTransform_View(const UObject* worldContextObject, FM
 		return;
 	}
 
-	if (const FTransformFragment* transformFragment = entity.EntityView.GetFragmentDataPtr<FTransformFragment>())
-	{
-		transform = transformFragment->GetTransform();
-	}
+	GetProjectileTransform(entity.EntityView, transform);
 }
 
 void UMassHelpers::GetEntityTransform_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity, FTransform& transform)
@@ -206,10 +597,7 @@ void UMassHelpers::GetEntityTransform_Handle(const UObject* worldContextObject,
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (const FTransformFragment* transformFragment = entityManager.GetFragmentDataPtr<FTransformFragment>(entity.Handle))
-		{
-			transform = transformFragment->GetTransform();
-		}
+		GetProjectileTransform(FMassEntityView(entityManager, entity.Handle), transform);
 	}
 }
 
@@ -220,10 +608,7 @@ void UMassHelpers::SetEntityVelocity_View(const UObject* worldContextObject, FMa
 		return;
 	}
 
-	if (FMassVelocityFragment* velocityFragment = entity.EntityView.GetFragmentDataPtr<FMassVelocityFragment>())
-	{
-		velocityFragment->Value = velocity;
-	}
+	SetProjectileVelocity(entity.EntityView, velocity);
 }
 
 void UMassHelpers::SetEntityVelocity_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity, const FVector& velocity)
@@ -236,10 +621,7 @@ void UMassHelpers::SetEntityVelocity_Handle(const UObject* worldContextObject, F
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (FMassVelocityFragment* velocityFragment = entityManager.GetFragmentDataPtr<FMassVelocityFragment>(entity.Handle))
-		{
-			velocityFragment->Value = velocity;
-		}
+		SetProjectileVelocity(FMassEntityView(entityManager, entity.Handle), velocity);
 	}
 }
 
@@ -250,10 +632,7 @@ void UMassHelpers::GetEntityVelocity_View(const UObject* worldContextObject, FMa
 		return;
 	}
 
-	if (const FMassVelocityFragment* velocityFragment = entity.EntityView.GetFragmentDataPtr<FMassVelocityFragment>())
-	{
-		velocity = velocityFragment->Value;
-	}
+	GetProjectileVelocity(entity.EntityView, velocity);
 }
 
 void UMassHelpers::GetEntityVelocity_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity, FVector& velocity)
@@ -266,10 +645,7 @@ void UMassHelpers::GetEntityVelocity_Handle(const UObject* worldContextObject, F
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (const FMassVelocityFragment* velocityFragment = entityManager.GetFragmentDataPtr<FMassVelocityFragment>(entity.Handle))
-		{
-			velocity = velocityFragment->Value;
-		}
+		GetProjectileVelocity(FMassEntityView(entityManager, entity.Handle), velocity);
 	}
 }
 
@@ -280,7 +656,8 @@ void UMassHelpers::SetEntityForce_View(const UObject* worldContextObject, FMassE
 		return;
 	}
 
-	if (FMassForceFragment* forceFragment = entity.EntityView.GetFragmentDataPtr<FMassForceFragment>())
+	FMassForceFragment* forceFragment = entity.EntityView.GetFragmentDataPtr<FMassForceFragment>();
+	if (ensureMsgf(forceFragment, TEXT("Entity has no force, compact state layouts don't store it. Set bUsesForce on its trait")))
 	{
 		forceFragment->Value = force;
 	}
@@ -296,7 +673,8 @@ void UMassHelpers::SetEntityForce_Handle(const UObject* worldContextObject, FMas
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (FMassForceFragment* forceFragment = entityManager.GetFragmentDataPtr<FMassForceFragment>(entity.Handle))
+		FMassForceFragment* forceFragment = entityManager.GetFragmentDataPtr<FMassForceFragment>(entity.Handle);
+		if (ensureMsgf(forceFragment, TEXT("Entity has no force, compact state layouts don't store it. Set bUsesForce on its trait")))
 		{
 			forceFragment->Value = force;
 		}
@@ -310,10 +688,8 @@ void UMassHelpers::GetEntityForce_View(const UObject* worldContextObject, FMassE
 		return;
 	}
 
-	if (const FMassForceFragment* forceFragment = entity.EntityView.GetFragmentDataPtr<FMassForceFragment>())
-	{
-		force = forceFragment->Value;
-	}
+	const FMassForceFragment* forceFragment = entity.EntityView.GetFragmentDataPtr<FMassForceFragment>();
+	force = ensureMsgf(forceFragment, TEXT("Entity has no force, compact state layouts don't store it. Set bUsesForce on its trait")) ? forceFragment->Value : FVector::ZeroVector;
 }
 
 void UMassHelpers::GetEntityForce_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity, FVector& force)
@@ -326,10 +702,8 @@ void UMassHelpers::GetEntityForce_Handle(const UObject* worldContextObject, FMas
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (const FMassForceFragment* forceFragment = entityManager.GetFragmentDataPtr<FMassForceFragment>(entity.Handle))
-		{
-			force = forceFragment->Value;
-		}
+		const FMassForceFragment* forceFragment = entityManager.GetFragmentDataPtr<FMassForceFragment>(entity.Handle);
+		force = ensureMsgf(forceFragment, TEXT("Entity has no force, compact state layouts don't store it. Set bUsesForce on its trait")) ? forceFragment->Value : FVector::ZeroVector;
 	}
 }
 
@@ -340,10 +714,9 @@ void UMassHelpers::SetEntityInstigatorOwner_View(const UObject* worldContextObje
 		return;
 	}
 
-	if (FInstigatorOwnerFragment* instigatorOwner = entity.EntityView.GetFragmentDataPtr<FInstigatorOwnerFragment>())
+	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
-		instigatorOwner->InstigatorActor = instigator;
-		instigatorOwner->Owner = owner;
+		SetInstigatorOwner(*world, entity.EntityView, instigator, owner);
 	}
 }
 
@@ -357,14 +730,33 @@ void UMassHelpers::SetEntityInstigatorOwner_Handle(const UObject* worldContextOb
 	if (const UWorld* world = GEngine->GetWorldFromContextObject(worldContextObject, EGetWorldErrorMode::LogAndReturnNull))
 	{
 		const FMassEntityManager& entityManager = world->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
-		if (FInstigatorOwnerFragment* instigatorOwner = entityManager.GetFragmentDataPtr<FInstigatorOwnerFragment>(entity.Handle))
-		{
-			instigatorOwner->InstigatorActor = instigator;
-			instigatorOwner->Owner = owner;
-		}
+		SetInstigatorOwner(*world, FMassEntityView(entityManager, entity.Handle), instigator, owner);
 	}
 }
 
+void UMassHelpers::SetInstigatorOwner(const UWorld& world, const FMassEntityView& view, AActor* instigator, AActor* owner)
+{
+	FInstigatorOwnerFragment* instigatorOwner = view.GetFragmentDataPtr<FInstigatorOwnerFragment>();
+	if (instigatorOwner == nullptr)
+	{
+		return;
+	}
+
+	// Remote players may only confirm hits for shots the server has seen them fire, from where and in the direction it saw
+	const FProjectileTypeIdFragment* typeIdFragment = view.GetFragmentDataPtr<FProjectileTypeIdFragment>();
+	if (typeIdFragment && instigator && instigatorOwner->InstigatorActor.Get() != instigator)
+	{
+		FTransform transform;
+		FVector velocity = FVector::ZeroVector;
+		GetProjectileTransform(view, transform);
+		GetProjectileVelocity(view, velocity);
+		UProjectileHitConfirmationComponent::RegisterShot(world, instigator, typeIdFragment->TypeId, transform.GetLocation(), velocity);
+	}
+
+	instigatorOwner->InstigatorActor = instigator;
+	instigatorOwner->Owner = owner;
+}
+
 AActor* UMassHelpers::GetEntityInstigator_View(const UObject* worldContextObject, FMassEntityViewWrapper entity)
 {
 	if (IsEntityValid_View(worldContextObject, entity))
@@ -8,6 +8,7 @@
 #include "MassHelpers.generated.h"
 
 class UMassEntityConfigAsset;
+struct FProjectileHitscanFragment;
 
 // Not for storing, transient handle to an entity within an archetype 
 // Guaranteed to only be valid within the scope it was created
@@ -44,6 +45,31 @@ struct FMassEntityHandleWrapper
 	FMassEntityHandle Handle;
 };
 
+// Initial state for a projectile spawned by type id, see UProjectileCatalogSubsystem
+USTRUCT(BlueprintType)
+struct FProjectileSpawnParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 TypeId = MAX_uint16;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FTransform Transform;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Velocity = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<AActor> Instigator = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<AActor> Owner = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<TObjectPtr<AActor>> IgnoredActors;
+};
+
 UENUM()
 enum class EMassHelpersReturnSuccess : uint8
 {
@@ -55,11 +81,24 @@ UCLASS()
 class LYRAGAME_API UMassHelpers : public UBlueprintFunctionLibrary
 {
 	GENERATED_BODY()
-	
+
+public:
 	UFUNCTION(BlueprintCallable, Category = "Mass Helpers", meta = (DisplayName = "Spawn Entity From Entity Config", WorldContext = "worldContextObject", ExpandEnumAsExecs = "returnBranch"))
 	static FMassEntityViewWrapper BP_SpawnEntityFromEntityConfig(const UObject* worldContextObject, UMassEntityConfigAsset* massEntityConfig, EMassHelpersReturnSuccess& returnBranch);
 	static FMassEntityViewWrapper SpawnEntityFromEntityConfig(const UWorld* world, UMassEntityConfigAsset* massEntityConfig);
 
+	UFUNCTION(BlueprintCallable, Category = "Mass Helpers", meta = (DisplayName = "Spawn Projectile", WorldContext = "worldContextObject", ExpandEnumAsExecs = "returnBranch"))
+	static FMassEntityViewWrapper BP_SpawnProjectile(const UObject* worldContextObject, const FProjectileSpawnParams& spawnParams, EMassHelpersReturnSuccess& returnBranch);
+	static FMassEntityViewWrapper SpawnEntityFromTypeId(const UWorld* world, uint16 typeId);
+	// Projectiles fast enough to take the hitscan path have their hit scheduled instead and only spawn their tracer, if any
+	static FMassEntityViewWrapper SpawnProjectile(const UWorld* world, const FProjectileSpawnParams& spawnParams, bool* bOutWasHitscan = nullptr);
+	// Spawns each type in one batch, returns how many were spawned. Used to drain UProjectileSpawnQueueSubsystem
+	static int32 SpawnProjectileBatch(const UWorld* world, TConstArrayView<FProjectileSpawnParams> spawnParams);
+
+	// Lookup only, configs outside the projectile catalog have no type id and return INDEX_NONE
+	UFUNCTION(BlueprintPure, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Get Projectile Type Id"))
+	static int32 GetProjectileTypeId(const UObject* worldContextObject, UMassEntityConfigAsset* massEntityConfig);
+
 	UFUNCTION(BlueprintCallable, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Destroy Entity (view)"))
 	static void DestroyEntity_View(const UObject* worldContextObject, FMassEntityViewWrapper entity);
 	UFUNCTION(BlueprintCallable, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Destroy Entity (handle)"))
@@ -80,6 +119,12 @@ class LYRAGAME_API UMassHelpers : public UBlueprintFunctionLibrary
 	UFUNCTION(BlueprintPure, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Is Entity Valid (handle)"))
 	static bool IsEntityValid_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity);
 
+	// Work with any EProjectileStateLayout, return false if the entity has no state to read or write
+	static bool SetProjectileTransform(const FMassEntityView& view, const FTransform& transform);
+	static bool GetProjectileTransform(const FMassEntityView& view, FTransform& outTransform);
+	static bool SetProjectileVelocity(const FMassEntityView& view, const FVector& velocity);
+	static bool GetProjectileVelocity(const FMassEntityView& view, FVector& outVelocity);
+
 	UFUNCTION(BlueprintCallable, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Set Entity Transform (view)", AutoCreateRefTerm="transform"))
 	static void SetEntityTransform_View(const UObject* worldContextObject, FMassEntityViewWrapper entity, const FTransform& transform);
 	UFUNCTION(BlueprintCallable, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Set Entity Transform (handle)", AutoCreateRefTerm="trasnform"))
@@ -142,4 +187,13 @@ class LYRAGAME_API UMassHelpers : public UBlueprintFunctionLibrary
 	static void GetEntityIgnoredComponents_View(const UObject* worldContextObject, FMassEntityViewWrapper entity, TArray<UPrimitiveComponent*>& ignoredActors);
 	UFUNCTION(BlueprintPure, Category = "Mass Helpers", meta = (WorldContext = "worldContextObject", DisplayName = "Get Entity Ignored Components (handle)"))
 	static void GetEntityIgnoredComponents_Handle(const UObject* worldContextObject, FMassEntityHandleWrapper entity, TArray<UPrimitiveComponent*>& ignoredActors);
+
+private:
+	static FMassEntityViewWrapper SpawnEntityFromTemplateInternal(const UWorld* world, uint16 typeId);
+	// Type id and spawn time, for every entity spawned through here
+	static void InitSpawnedEntity(const UWorld& world, const FMassEntityView& view, uint16 typeId);
+	static void InitProjectileState(const UWorld& world, const FMassEntityView& view, const FProjectileSpawnParams& spawnParams);
+	static void SetInstigatorOwner(const UWorld& world, const FMassEntityView& view, AActor* instigator, AActor* owner);
+	// Sweeps the whole arc and schedules the hit when the type has a hitscan fragment and the launch is fast enough
+	static const FProjectileHitscanFragment* ResolveHitscan(const UWorld* world, const FProjectileSpawnParams& spawnParams);
 };
@@ -0,0 +1,264 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileBudgetSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "MassCommonFragments.h"
+#include "MassEntitySubsystem.h"
+#include "MassExecutionContext.h"
+#include "MassSimulationSubsystem.h"
+#include "Mass/LightweightProjectileSettings.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileSpawnQueueSubsystem.h"
+#include "Mass/ProjectileStats.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Projectiles"), STAT_ProjectileBudget_NumLive, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Evicted (Global Cap)"), STAT_ProjectileBudget_EvictedGlobal, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Evicted (Type Cap)"), STAT_ProjectileBudget_EvictedPerType, STATGROUP_LightweightProjectiles);
+
+void UProjectileBudgetSubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	EntitySubsystem = collection.InitializeDependency<UMassEntitySubsystem>();
+	SpawnQueueSubsystem = collection.InitializeDependency<UProjectileSpawnQueueSubsystem>();
+	if (UMassSimulationSubsystem* simulationSS = collection.InitializeDependency<UMassSimulationSubsystem>())
+	{
+		PhaseStartedHandle = simulationSS->GetOnProcessingPhaseStarted(EMassProcessingPhase::PrePhysics).AddUObject(this, &UProjectileBudgetSubsystem::OnPrePhysicsPhaseStarted);
+	}
+
+	BudgetQuery.AddRequirement<FProjectileSpawnTimeFragment>(EMassFragmentAccess::ReadOnly);
+	BudgetQuery.AddConstSharedRequirement<FProjectileBudgetFragment>(EMassFragmentPresence::Optional);
+	BudgetQuery.AddRequirement<FProjectileTypeIdFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+
+	// Whichever state layout the archetype uses, for distance to players
+	BudgetQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+	BudgetQuery.AddRequirement<FProjectileStateFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+	BudgetQuery.AddRequirement<FProjectileRelativeStateFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+}
+
+void UProjectileBudgetSubsystem::Deinitialize()
+{
+	if (UMassSimulationSubsystem* simulationSS = UWorld::GetSubsystem<UMassSimulationSubsystem>(GetWorld()))
+	{
+		simulationSS->GetOnProcessingPhaseStarted(EMassProcessingPhase::PrePhysics).Remove(PhaseStartedHandle);
+	}
+	PhaseStartedHandle.Reset();
+	EntitySubsystem = nullptr;
+	SpawnQueueSubsystem = nullptr;
+
+	Super::Deinitialize();
+}
+
+int32 UProjectileBudgetSubsystem::GetMaxLiveProjectiles() const
+{
+	return MaxLiveProjectilesOverride >= 0 ? MaxLiveProjectilesOverride : GetDefault<ULightweightProjectileSettings>()->MaxLiveProjectiles;
+}
+
+void UProjectileBudgetSubsystem::ReportFrame(int32 numLive, int32 numEvictedGlobal, int32 numEvictedPerType)
+{
+	NumLiveProjectiles = numLive - numEvictedGlobal - numEvictedPerType;
+	SET_DWORD_STAT(STAT_ProjectileBudget_NumLive, NumLiveProjectiles);
+
+	if (numEvictedGlobal + numEvictedPerType == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_ProjectileBudget_EvictedGlobal, numEvictedGlobal);
+	INC_DWORD_STAT_BY(STAT_ProjectileBudget_EvictedPerType, numEvictedPerType);
+	TotalEvictedGlobal += numEvictedGlobal;
+	TotalEvictedPerType += numEvictedPerType;
+	UnloggedEvictions += numEvictedGlobal + numEvictedPerType;
+
+	UE_LOG(LogLightweightProjectiles, Verbose, TEXT("Projectile budget evicted %d (global cap) and %d (type caps) of %d live projectiles"), numEvictedGlobal, numEvictedPerType, numLive);
+
+	const double now = FPlatformTime::Seconds();
+	if (now - LastLogTime >= 1.0)
+	{
+		UE_LOG(LogLightweightProjectiles, Log, TEXT("Projectile budget evicted %d projectiles since the last report, %lld in total (%lld global cap, %lld type caps), global cap %d"),
+			UnloggedEvictions, GetTotalEvicted(), TotalEvictedGlobal, TotalEvictedPerType, GetMaxLiveProjectiles());
+		UnloggedEvictions = 0;
+		LastLogTime = now;
+	}
+}
+
+void UProjectileBudgetSubsystem::OnPrePhysicsPhaseStarted(float deltaSeconds)
+{
+	// Phase start delegates run in no particular order, so queued spawns are made here to be sure they count against this frame's budget
+	if (SpawnQueueSubsystem)
+	{
+		SpawnQueueSubsystem->SpawnQueued();
+	}
+
+	if (EntitySubsystem)
+	{
+		EnforceBudget(EntitySubsystem->GetMutableEntityManager());
+	}
+}
+
+void UProjectileBudgetSubsystem::EnforceBudget(FMassEntityManager& entityManager)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileBudgetSubsystem_EnforceBudget);
+
+	FMassExecutionContext context = entityManager.CreateExecutionContext(0.f);
+	UWorld* world = GetWorld();
+	const float now = world->GetTimeSeconds();
+
+	struct FCappedType
+	{
+		int32 NumAlive = 0;
+		int32 MaxAlive = 0;
+	};
+	// Shared fragment values don't split archetypes and tags split one type over several, so caps are grouped by the
+	// type id and the budget fragment rather than by archetype
+	using FGroupKey = TPair<const FProjectileBudgetFragment*, uint16>;
+	TMap<FGroupKey, int32, TInlineSetAllocator<16>> typeToGroup;
+	TArray<FCappedType, TInlineAllocator<16>> groups;
+
+	auto findGroup = [&typeToGroup, &groups](const FProjectileBudgetFragment& budget, uint16 typeId)
+	{
+		const int32 group = typeToGroup.FindOrAdd(FGroupKey(&budget, typeId), groups.Num());
+		if (group == groups.Num())
+		{
+			groups.Add({ 0, budget.MaxAlive });
+		}
+		return group;
+	};
+
+	// Counting only needs chunk sizes, and type ids for capped types, so the common under-budget frame barely touches per-entity data
+	int32 numLive = 0;
+	BudgetQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		const int32 numEntities = context.GetNumEntities();
+		numLive += numEntities;
+
+		if (const FProjectileBudgetFragment* budget = context.GetConstSharedFragmentPtr<FProjectileBudgetFragment>())
+		{
+			TConstArrayView<FProjectileTypeIdFragment> typeIds = context.GetFragmentView<FProjectileTypeIdFragment>();
+			if (typeIds.Num() == 0)
+			{
+				groups[findGroup(*budget, MAX_uint16)].NumAlive += numEntities;
+				return;
+			}
+
+			// Runs of one type are the norm, so only look the group up when the type changes
+			int32 group = INDEX_NONE;
+			uint16 groupTypeId = MAX_uint16;
+			for (int32 idx = 0; idx < numEntities; ++idx)
+			{
+				if (group == INDEX_NONE || typeIds[idx].TypeId != groupTypeId)
+				{
+					groupTypeId = typeIds[idx].TypeId;
+					group = findGroup(*budget, groupTypeId);
+				}
+				++groups[group].NumAlive;
+			}
+		}
+	});
+
+	const int32 globalCap = GetMaxLiveProjectiles();
+	int32 numOverGlobalCap = globalCap > 0 ? FMath::Max(numLive - globalCap, 0) : 0;
+	const bool bOverTypeCap = groups.ContainsByPredicate([](const FCappedType& group) { return group.NumAlive > group.MaxAlive; });
+	if (numOverGlobalCap == 0 && !bOverTypeCap)
+	{
+		ReportFrame(numLive, 0, 0);
+		return;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileBudgetSubsystem_Evict);
+
+	const ULightweightProjectileSettings* settings = GetDefault<ULightweightProjectileSettings>();
+
+	TArray<FVector, TInlineAllocator<16>> playerLocations;
+	for (FConstPlayerControllerIterator it = world->GetPlayerControllerIterator(); it; ++it)
+	{
+		if (const APlayerController* pc = it->Get())
+		{
+			FVector location;
+			FRotator rotation;
+			pc->GetPlayerViewPoint(location, rotation);
+			playerLocations.Add(location);
+		}
+	}
+
+	// Score every projectile in one pass, higher scores go first
+	Candidates.Reset(numLive);
+	BudgetQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		const int32 numEntities = context.GetNumEntities();
+		TConstArrayView<FProjectileSpawnTimeFragment> spawnTimes = context.GetFragmentView<FProjectileSpawnTimeFragment>();
+		TConstArrayView<FTransformFragment> transforms = context.GetFragmentView<FTransformFragment>();
+		TConstArrayView<FProjectileStateFragment> states = context.GetFragmentView<FProjectileStateFragment>();
+		TConstArrayView<FProjectileRelativeStateFragment> relativeStates = context.GetFragmentView<FProjectileRelativeStateFragment>();
+		TConstArrayView<FProjectileTypeIdFragment> typeIds = context.GetFragmentView<FProjectileTypeIdFragment>();
+
+		const FProjectileBudgetFragment* budget = context.GetConstSharedFragmentPtr<FProjectileBudgetFragment>();
+		const float chunkBias = context.DoesArchetypeHaveTag<FProjectileCosmeticTag>() ? settings->EvictionCosmeticBias : 0.f;
+
+		for (int32 idx = 0; idx < numEntities; ++idx)
+		{
+			float score = chunkBias + (now - spawnTimes[idx].SpawnTime) * settings->EvictionAgeWeight;
+
+			if (playerLocations.Num() > 0 && settings->EvictionDistanceWeight != 0.f)
+			{
+				const FVector location = transforms.Num() > 0 ? transforms[idx].GetTransform().GetTranslation()
+					: states.Num() > 0 ? states[idx].GetPosition()
+					: relativeStates.Num() > 0 ? relativeStates[idx].GetPosition()
+					: playerLocations[0];
+
+				double closestDistanceSquared = UE_DOUBLE_BIG_NUMBER;
+				for (const FVector& playerLocation : playerLocations)
+				{
+					closestDistanceSquared = FMath::Min(closestDistanceSquared, FVector::DistSquared(location, playerLocation));
+				}
+				score += (float)(FMath::Sqrt(closestDistanceSquared) * 0.01) * settings->EvictionDistanceWeight;
+			}
+
+			const int32* group = budget ? typeToGroup.Find(FGroupKey(budget, typeIds.Num() > 0 ? typeIds[idx].TypeId : MAX_uint16)) : nullptr;
+			Candidates.Add({ context.GetEntity(idx), score, group ? *group : INDEX_NONE });
+		}
+	});
+
+	Algo::SortBy(Candidates, &FEvictionCandidate::Score, TGreater<float>());
+
+	// Type caps first, whatever they free up counts towards the global cap
+	EntitiesToEvict.Reset();
+	int32 numEvictedPerType = 0;
+	if (bOverTypeCap)
+	{
+		for (FEvictionCandidate& candidate : Candidates)
+		{
+			if (candidate.Group == INDEX_NONE)
+			{
+				continue;
+			}
+
+			FCappedType& group = groups[candidate.Group];
+			if (group.NumAlive > group.MaxAlive)
+			{
+				--group.NumAlive;
+				EntitiesToEvict.Add(candidate.Entity);
+				candidate.Entity = FMassEntityHandle();
+				++numEvictedPerType;
+			}
+		}
+		numOverGlobalCap = FMath::Max(numOverGlobalCap - numEvictedPerType, 0);
+	}
+
+	int32 numEvictedGlobal = 0;
+	for (const FEvictionCandidate& candidate : Candidates)
+	{
+		if (numEvictedGlobal >= numOverGlobalCap)
+		{
+			break;
+		}
+		if (candidate.Entity.IsSet())
+		{
+			EntitiesToEvict.Add(candidate.Entity);
+			++numEvictedGlobal;
+		}
+	}
+
+	// Nothing is processing yet, so these are gone before movement rather than at the end of the phase
+	entityManager.BatchDestroyEntities(EntitiesToEvict);
+	ReportFrame(numLive, numEvictedGlobal, numEvictedPerType);
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityQuery.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileBudgetSubsystem.generated.h"
+
+class UMassEntitySubsystem;
+class UProjectileSpawnQueueSubsystem;
+struct FMassEntityManager;
+
+/**
+ * Caps how many lightweight projectiles can be alive, so the worst case tick cost is bounded.
+ * Evicts when the Mass PrePhysics phase starts, before movement and right after UProjectileSpawnQueueSubsystem's queued
+ * spawns are made, destroying the oldest, furthest from any player and cosmetic-only projectiles first
+ */
+UCLASS()
+class LYRAGAME_API UProjectileBudgetSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+	virtual void Deinitialize() override;
+
+	// Overrides ULightweightProjectileSettings::MaxLiveProjectiles for this world, negative restores the project setting
+	UFUNCTION(BlueprintCallable, Category = "Projectile Budget")
+	void SetMaxLiveProjectiles(int32 maxLiveProjectiles) { MaxLiveProjectilesOverride = maxLiveProjectiles; }
+
+	// 0 for no limit
+	UFUNCTION(BlueprintPure, Category = "Projectile Budget")
+	int32 GetMaxLiveProjectiles() const;
+
+	UFUNCTION(BlueprintPure, Category = "Projectile Budget")
+	int32 GetNumLiveProjectiles() const { return NumLiveProjectiles; }
+
+	UFUNCTION(BlueprintPure, Category = "Projectile Budget")
+	int64 GetTotalEvicted() const { return TotalEvictedGlobal + TotalEvictedPerType; }
+
+protected:
+	void OnPrePhysicsPhaseStarted(float deltaSeconds);
+	void EnforceBudget(FMassEntityManager& entityManager);
+
+	// Once per frame, live count is before eviction
+	void ReportFrame(int32 numLive, int32 numEvictedGlobal, int32 numEvictedPerType);
+
+	FMassEntityQuery BudgetQuery;
+	FDelegateHandle PhaseStartedHandle;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMassEntitySubsystem> EntitySubsystem;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileSpawnQueueSubsystem> SpawnQueueSubsystem;
+
+	struct FEvictionCandidate
+	{
+		FMassEntityHandle Entity;
+		float Score = 0.f;
+		// Index into the frame's capped types, INDEX_NONE when only the global cap applies
+		int32 Group = INDEX_NONE;
+	};
+
+	// Kept around to avoid reallocating on frames that are over budget
+	TArray<FEvictionCandidate> Candidates;
+	TArray<FMassEntityHandle> EntitiesToEvict;
+
+	int32 MaxLiveProjectilesOverride = -1;
+	int32 NumLiveProjectiles = 0;
+
+	int64 TotalEvictedGlobal = 0;
+	int64 TotalEvictedPerType = 0;
+
+	// Evictions since the last log line, logged at most once a second
+	int32 UnloggedEvictions = 0;
+	double LastLogTime = 0.0;
+};
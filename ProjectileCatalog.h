@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ProjectileCatalog.generated.h"
+
+class UMassEntityConfigAsset;
+
+/**
+ * List of projectile entity configs, the index of each entry is its projectile type id
+ * Keep the order stable, type ids are used as network archetype identifiers
+ */
+UCLASS(BlueprintType)
+class LYRAGAME_API UProjectileCatalog : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<TObjectPtr<UMassEntityConfigAsset>> ProjectileConfigs;
+};
@@ -0,0 +1,268 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileCatalogSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "MassEntityConfigAsset.h"
+#include "MassEntitySubsystem.h"
+#include "MassSpawnerSubsystem.h"
+#include "Mass/LightweightProjectileSettings.h"
+#include "Mass/ProjectileCatalog.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileStats.h"
+
+void UProjectileCatalogSubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	// Templates need the entity manager to create archetypes and shared fragments
+	collection.InitializeDependency<UMassEntitySubsystem>();
+	collection.InitializeDependency<UMassSpawnerSubsystem>();
+}
+
+void UProjectileCatalogSubsystem::Deinitialize()
+{
+	Configs.Reset();
+	Templates.Reset();
+	SpawnableTypes.Reset();
+	ConfigToTypeId.Reset();
+
+	for (const TSharedPtr<FStreamableHandle>& handle : PreloadHandles)
+	{
+		handle->CancelHandle();
+	}
+	PreloadHandles.Reset();
+
+	Super::Deinitialize();
+}
+
+void UProjectileCatalogSubsystem::OnWorldBeginPlay(UWorld& world)
+{
+	Super::OnWorldBeginPlay(world);
+
+	const ULightweightProjectileSettings* settings = GetDefault<ULightweightProjectileSettings>();
+	if (const UProjectileCatalog* catalog = settings->ProjectileCatalog.LoadSynchronous())
+	{
+		BuildCatalog(*catalog);
+
+		if (settings->bPreloadCatalogOnBeginPlay)
+		{
+			TArray<uint16> typeIds;
+			for (int32 typeId = 0; typeId < Configs.Num(); ++typeId)
+			{
+				typeIds.Add(static_cast<uint16>(typeId));
+			}
+			PreloadTypes(typeIds);
+		}
+	}
+}
+
+bool UProjectileCatalogSubsystem::DoesSupportWorldType(EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
+
+void UProjectileCatalogSubsystem::BuildCatalog(const UProjectileCatalog& catalog)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileCatalogSubsystem_BuildCatalog);
+
+	if (!ensureMsgf(Configs.Num() == 0, TEXT("Projectile catalog already built")))
+	{
+		return;
+	}
+
+	Configs.Reserve(catalog.ProjectileConfigs.Num());
+	Templates.Reserve(catalog.ProjectileConfigs.Num());
+
+	for (UMassEntityConfigAsset* config : catalog.ProjectileConfigs)
+	{
+		if (ensureMsgf(IsValid(config), TEXT("Null entry in projectile catalog %s"), *catalog.GetName()))
+		{
+			RegisterConfig(config);
+		}
+	}
+}
+
+uint16 UProjectileCatalogSubsystem::RegisterConfig(UMassEntityConfigAsset* massEntityConfig)
+{
+	if (!IsValid(massEntityConfig))
+	{
+		return InvalidTypeId;
+	}
+
+	if (const uint16* existingId = ConfigToTypeId.Find(massEntityConfig))
+	{
+		return *existingId;
+	}
+
+	if (!ensureMsgf(Configs.Num() < InvalidTypeId && Templates.Num() < Templates.Max(), TEXT("Ran out of projectile type ids")))
+	{
+		return InvalidTypeId;
+	}
+
+	const UWorld* world = GetWorld();
+	check(world);
+
+	const uint16 typeId = static_cast<uint16>(Configs.Num());
+	Configs.Add(massEntityConfig);
+	// Take a copy so we don't depend on the registry's storage staying put
+	const FMassEntityTemplate& entityTemplate = Templates.Add_GetRef(massEntityConfig->GetConfig().GetOrCreateEntityTemplate(*world));
+	SpawnableTypes.Add(ShouldSpawnInWorld(*world, entityTemplate));
+	ConfigToTypeId.Add(massEntityConfig, typeId);
+
+	return typeId;
+}
+
+void UProjectileCatalogSubsystem::PreloadProjectiles(const TArray<UMassEntityConfigAsset*>& massEntityConfigs)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileCatalogSubsystem_PreloadProjectiles);
+
+	// Never registers, type ids have to come out the same on every machine whatever each one preloaded first
+	TArray<FSoftObjectPath> paths;
+	for (const UMassEntityConfigAsset* config : massEntityConfigs)
+	{
+		if (const FMassEntityTemplate* entityTemplate = WarmTemplate(config))
+		{
+			GatherSoftReferences(*entityTemplate, paths);
+		}
+	}
+	LoadSoftReferences(MoveTemp(paths));
+}
+
+void UProjectileCatalogSubsystem::PreloadTypes(TConstArrayView<uint16> typeIds)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileCatalogSubsystem_PreloadTypes);
+
+	TArray<FSoftObjectPath> paths;
+	for (const uint16 typeId : typeIds)
+	{
+		if (const FMassEntityTemplate* entityTemplate = GetTemplate(typeId))
+		{
+			GatherSoftReferences(*entityTemplate, paths);
+		}
+	}
+	LoadSoftReferences(MoveTemp(paths));
+}
+
+const FMassEntityTemplate* UProjectileCatalogSubsystem::WarmTemplate(const UMassEntityConfigAsset* massEntityConfig) const
+{
+	if (!IsValid(massEntityConfig))
+	{
+		return nullptr;
+	}
+
+	const uint16 typeId = FindTypeId(massEntityConfig);
+	if (typeId != InvalidTypeId)
+	{
+		return GetTemplate(typeId);
+	}
+
+	// Uncatalogued configs spawn from the registry's template, building it now creates the archetype and shared fragments
+	const UWorld* world = GetWorld();
+	check(world);
+	return &massEntityConfig->GetConfig().GetOrCreateEntityTemplate(*world);
+}
+
+void UProjectileCatalogSubsystem::LoadSoftReferences(TArray<FSoftObjectPath>&& paths)
+{
+	// Drop anything already in memory so the log only counts real loads
+	paths.RemoveAllSwap([](const FSoftObjectPath& path) { return path.IsNull() || path.ResolveObject() != nullptr; });
+	if (paths.Num() == 0)
+	{
+		return;
+	}
+
+	const double startTime = FPlatformTime::Seconds();
+	const int32 numPaths = paths.Num();
+	TSharedPtr<FStreamableHandle> handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(paths), [startTime, numPaths]()
+	{
+		UE_LOG(LogLightweightProjectiles, Log, TEXT("Preloaded %d projectile assets in %.1f ms"), numPaths, (FPlatformTime::Seconds() - startTime) * 1000.0);
+	});
+	if (handle.IsValid())
+	{
+		PreloadHandles.Add(MoveTemp(handle));
+	}
+}
+
+void UProjectileCatalogSubsystem::GatherSoftReferences(const FMassEntityTemplate& entityTemplate, TArray<FSoftObjectPath>& outPaths) const
+{
+	// Covers FGEDamageFragment, FProjectileAreaDamageFragment and whatever traits add later without listing them here
+	for (const FConstSharedStruct& sharedFragment : entityTemplate.GetSharedFragmentValues().GetConstSharedFragments())
+	{
+		const UScriptStruct* fragmentType = sharedFragment.GetScriptStruct();
+		for (TFieldIterator<FSoftObjectProperty> it(fragmentType); it; ++it)
+		{
+			const FSoftObjectPtr* softPtr = it->ContainerPtrToValuePtr<FSoftObjectPtr>(sharedFragment.GetMemory());
+			if (!softPtr->IsNull())
+			{
+				outPaths.AddUnique(softPtr->ToSoftObjectPath());
+			}
+		}
+
+		// Tracers stand in for hitscan projectiles, they need a warm template just as much
+		if (fragmentType == FProjectileHitscanFragment::StaticStruct())
+		{
+			const FProjectileHitscanFragment& hitscan = sharedFragment.Get<FProjectileHitscanFragment>();
+			const FMassEntityTemplate* tracerTemplate = hitscan.TracerConfig ? WarmTemplate(hitscan.TracerConfig) : nullptr;
+			if (tracerTemplate && tracerTemplate != &entityTemplate)
+			{
+				GatherSoftReferences(*tracerTemplate, outPaths);
+			}
+		}
+	}
+}
+
+bool UProjectileCatalogSubsystem::ShouldSpawnInWorld(const UWorld& world, const FMassEntityTemplate& entityTemplate)
+{
+	const FMassTagBitSet& tags = entityTemplate.GetCompositionDescriptor().Tags;
+	switch (world.GetNetMode())
+	{
+	case NM_DedicatedServer:
+		return !tags.Contains<FProjectileCosmeticTag>();
+	case NM_Client:
+		return !tags.Contains<FProjectileServerOnlyTag>();
+	default:
+		// Standalone and listen servers are both server and client
+		return true;
+	}
+}
+
+const FConstSharedStruct* UProjectileCatalogSubsystem::FindConstSharedFragment(uint16 typeId, const UScriptStruct* fragmentType) const
+{
+	const FMassEntityTemplate* entityTemplate = GetTemplate(typeId);
+	if (entityTemplate == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (const FConstSharedStruct& sharedFragment : entityTemplate->GetSharedFragmentValues().GetConstSharedFragments())
+	{
+		if (sharedFragment.GetScriptStruct() == fragmentType)
+		{
+			return &sharedFragment;
+		}
+	}
+	return nullptr;
+}
+
+const FGEDamageFragment* UProjectileCatalogSubsystem::GetDamageFragment(uint16 typeId) const
+{
+	return GetConstSharedFragment<FGEDamageFragment>(typeId);
+}
+
+uint16 UProjectileCatalogSubsystem::FindTypeId(const UMassEntityConfigAsset* massEntityConfig) const
+{
+	const uint16* typeId = ConfigToTypeId.Find(massEntityConfig);
+	return typeId ? *typeId : InvalidTypeId;
+}
+
+const FMassEntityTemplate* UProjectileCatalogSubsystem::GetTemplate(uint16 typeId) const
+{
+	return Templates.IsValidIndex(typeId) ? &Templates[typeId] : nullptr;
+}
+
+UMassEntityConfigAsset* UProjectileCatalogSubsystem::GetConfig(uint16 typeId) const
+{
+	return Configs.IsValidIndex(typeId) ? Configs[typeId].Get() : nullptr;
+}
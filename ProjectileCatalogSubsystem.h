@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTemplate.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileCatalogSubsystem.generated.h"
+
+class UMassEntityConfigAsset;
+class UProjectileCatalog;
+struct FStreamableHandle;
+struct FGEDamageFragment;
+
+/**
+ * Builds every projectile template up front and hands out compact type ids for them
+ * Spawning by type id skips template resolution and shared fragment hashing entirely
+ */
+UCLASS()
+class LYRAGAME_API UProjectileCatalogSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr uint16 InvalidTypeId = MAX_uint16;
+
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& world) override;
+
+	uint16 FindTypeId(const UMassEntityConfigAsset* massEntityConfig) const;
+	const FMassEntityTemplate* GetTemplate(uint16 typeId) const;
+	UMassEntityConfigAsset* GetConfig(uint16 typeId) const;
+	int32 GetNumTypes() const { return Configs.Num(); }
+
+	// False when the type's EProjectileNetExecution excludes this world's net mode
+	bool IsTypeSpawnable(uint16 typeId) const { return SpawnableTypes.IsValidIndex(typeId) && SpawnableTypes[typeId]; }
+	static bool ShouldSpawnInWorld(const UWorld& world, const FMassEntityTemplate& entityTemplate);
+
+	// Builds the configs' templates now and async loads every soft reference in their shared fragments,
+	// so the first spawn and first hit don't pay for it. Call when equipping a weapon, the catalog itself is preloaded at begin play.
+	// Doesn't register anything, configs outside the catalog get their template warmed but still no type id
+	UFUNCTION(BlueprintCallable, Category = "Projectile Catalog")
+	void PreloadProjectiles(const TArray<UMassEntityConfigAsset*>& massEntityConfigs);
+	void PreloadTypes(TConstArrayView<uint16> typeIds);
+
+	const FConstSharedStruct* FindConstSharedFragment(uint16 typeId, const UScriptStruct* fragmentType) const;
+	template<typename T>
+	const T* GetConstSharedFragment(uint16 typeId) const
+	{
+		const FConstSharedStruct* sharedFragment = FindConstSharedFragment(typeId, T::StaticStruct());
+		return sharedFragment ? &sharedFragment->Get<T>() : nullptr;
+	}
+
+	const FGEDamageFragment* GetDamageFragment(uint16 typeId) const;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type worldType) const override;
+
+	// Type ids are indices into the catalog asset, so every machine loading the same catalog agrees on them
+	void BuildCatalog(const UProjectileCatalog& catalog);
+	// Only called while building the catalog, Templates is reserved up front so GetTemplate's pointers stay valid
+	uint16 RegisterConfig(UMassEntityConfigAsset* massEntityConfig);
+	// The catalog's template when the config has a type id, otherwise the one UMassHelpers spawns it from
+	const FMassEntityTemplate* WarmTemplate(const UMassEntityConfigAsset* massEntityConfig) const;
+	void GatherSoftReferences(const FMassEntityTemplate& entityTemplate, TArray<FSoftObjectPath>& outPaths) const;
+	void LoadSoftReferences(TArray<FSoftObjectPath>&& paths);
+
+	// Indexed by type id
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UMassEntityConfigAsset>> Configs;
+	TArray<FMassEntityTemplate> Templates;
+	TBitArray<> SpawnableTypes;
+
+	TMap<TObjectKey<UMassEntityConfigAsset>, uint16> ConfigToTypeId;
+
+	// Keeps preloaded assets resident for the lifetime of the world
+	TArray<TSharedPtr<FStreamableHandle>> PreloadHandles;
+};
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileClientHitProcessor.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameStateBase.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "MassSignalSubsystem.h"
+#include "Mass/ProjectileCatalogSubsystem.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileHitSubsystem.h"
+#include "Mass/ProjectileMovementProcessor.h"
+
+UProjectileClientHitProcessor::UProjectileClientHitProcessor()
+{
+	ExecutionFlags = (int32)EProcessorExecutionFlags::Client;
+
+	ExecutionOrder.ExecuteAfter.Add(UProjectileMovementProcessor::StaticClass()->GetFName());
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Behavior;
+}
+
+void UProjectileClientHitProcessor::Initialize(UObject& owner)
+{
+	Super::Initialize(owner);
+
+	UWorld* world = owner.GetWorld();
+	bIsRemoteClient = world && world->GetNetMode() == NM_Client;
+
+	UMassSignalSubsystem* signalSS = UWorld::GetSubsystem<UMassSignalSubsystem>(world);
+	SubscribeToSignal(*signalSS, UProjectileMovementProcessor::ProjectileEntityHitSignal);
+
+	HitSubsystem = UWorld::GetSubsystem<UProjectileHitSubsystem>(world);
+}
+
+void UProjectileClientHitProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FHitInfoFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FInstigatorOwnerFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FProjectileTypeIdFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+	EntityQuery.AddConstSharedRequirement<FGEDamageFragment>(EMassFragmentPresence::Optional);
+}
+
+void UProjectileClientHitProcessor::SignalEntities(FMassEntityManager& entityManager, FMassExecutionContext& context, FMassSignalNameLookup& entitysignals)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileClientHitProcessor_SignalEntities);
+
+	if (!bIsRemoteClient)
+	{
+		return;
+	}
+
+	const AGameStateBase* gameState = context.GetWorld()->GetGameState();
+	const double serverTime = gameState ? gameState->GetServerWorldTimeSeconds() : context.GetWorld()->GetTimeSeconds();
+
+	EntityQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		const FGEDamageFragment* damageFrag = context.GetConstSharedFragmentPtr<FGEDamageFragment>();
+		TConstArrayView<FProjectileTypeIdFragment> typeIds = context.GetFragmentView<FProjectileTypeIdFragment>();
+		if (HitSubsystem && damageFrag && typeIds.Num() > 0 && context.DoesArchetypeHaveTag<FProjectileClientConfirmedHitsTag>())
+		{
+			const int32 numEntities = context.GetNumEntities();
+			TArrayView<const FHitInfoFragment> hitInfos = context.GetFragmentView<FHitInfoFragment>();
+			TArrayView<const FInstigatorOwnerFragment> instigatorOwnerView = context.GetFragmentView<FInstigatorOwnerFragment>();
+
+			for (int32 idx = 0; idx < numEntities; ++idx)
+			{
+				// Spawned outside the catalog, the server has no way to identify the type
+				const uint16 typeId = typeIds[idx].TypeId;
+				if (typeId == UProjectileCatalogSubsystem::InvalidTypeId)
+				{
+					continue;
+				}
+
+				// Only our own shots are ours to report
+				const AController* controller = UProjectileHitSubsystem::GetInstigatorController(instigatorOwnerView[idx].InstigatorActor.Get());
+				const FHitResult& hit = hitInfos[idx].HitInfo;
+				AActor* hitActor = hit.GetActor();
+				if (controller == nullptr || !controller->IsLocalController() || hitActor == nullptr)
+				{
+					continue;
+				}
+
+				FProjectileConfirmedHit confirmedHit;
+				confirmedHit.EntityId = context.GetEntity(idx).Index;
+				confirmedHit.TypeId = typeId;
+				confirmedHit.Target = hitActor;
+				confirmedHit.RelativeImpactPoint = hit.ImpactPoint - hitActor->GetActorLocation();
+				confirmedHit.Time = serverTime;
+				HitSubsystem->QueueClientHit(confirmedHit);
+			}
+		}
+
+		entityManager.Defer().DestroyEntities(context.GetEntities());
+	});
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassSignalProcessorBase.h"
+#include "ProjectileClientHitProcessor.generated.h"
+
+class UProjectileHitSubsystem;
+
+/**
+ * Client side of hit processing, damage is resolved by the server so this retires the projectile,
+ * and reports our own hits for archetypes using client confirmed hits
+ */
+UCLASS()
+class LYRAGAME_API UProjectileClientHitProcessor : public UMassSignalProcessorBase
+{
+	GENERATED_BODY()
+
+public:
+	UProjectileClientHitProcessor();
+
+protected:
+	virtual void Initialize(UObject& owner) override;
+	virtual void ConfigureQueries() override;
+	virtual void SignalEntities(FMassEntityManager& entityManager, FMassExecutionContext& context, FMassSignalNameLookup& entitysignals) override;
+
+	// Listen servers count as clients too, but their UProjectileHitProcessor already handles hits
+	bool bIsRemoteClient = false;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileHitSubsystem> HitSubsystem;
+};
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "GameplayTagContainer.h"
 #include "MassCommonTypes.h"
+#include "Mass/ProjectileMovementKernel.h"
 #include "ProjectileFragments.generated.h"
 
 class UGameplayEffect;
+class UMassEntityConfigAsset;
 
 USTRUCT(BlueprintType)
 struct LYRAGAME_API FProjectileArchetypeDescription : public FMassSharedFragment
@@ -26,6 +29,39 @@ struct LYRAGAME_API FProjectileArchetypeDescription : public FMassSharedFragment
 	uint8 bRotationFollowsVelocity : 1;
 };
 
+UENUM(BlueprintType)
+enum class EProjectileNetExecution : uint8
+{
+	// Simulated everywhere, damage is resolved by the server
+	ServerAndClients,
+	// Never spawned on clients, e.g. projectiles with no visual representation
+	ServerOnly,
+	// Purely cosmetic, never spawned on dedicated servers
+	ClientsOnly
+};
+
+// Archetype only exists on the server, see EProjectileNetExecution
+USTRUCT()
+struct LYRAGAME_API FProjectileServerOnlyTag : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+// Archetype only exists on clients, see EProjectileNetExecution
+USTRUCT()
+struct LYRAGAME_API FProjectileCosmeticTag : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+// Hits by remote players' projectiles are sent by the owning client in batches and confirmed by the server,
+// rather than the server applying damage from its own simulation
+USTRUCT()
+struct LYRAGAME_API FProjectileClientConfirmedHitsTag : public FMassTag
+{
+	GENERATED_BODY()
+};
+
 USTRUCT(BlueprintType)
 struct LYRAGAME_API FCollisionIgnoredFragment : public FMassFragment
 {
@@ -44,6 +80,48 @@ struct LYRAGAME_API FGEDamageFragment : public FMassSharedFragment
 	TSoftClassPtr<UGameplayEffect> DamageEffect;
 };
 
+// Damage dealt to everything within Radius of the impact. UProjectileHitProcessor gathers the frame's explosions
+// and resolves them together, one overlap per occupied grid cell
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FProjectileAreaDamageFragment : public FMassSharedFragment
+{
+	GENERATED_BODY()
+
+	// 0 disables area damage
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Radius = 0.f;
+
+	// Fraction of the radius which takes full damage
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "1"))
+	float InnerRadiusFraction = 0.f;
+
+	// Shape of the falloff between the inner radius and Radius, 1 is linear
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float FalloffExponent = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftClassPtr<UGameplayEffect> DamageEffect;
+
+	// Set on the effect spec to the target's damage scale, summed over every blast that reached it this frame.
+	// Leave empty to apply the effect unscaled, once per target
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FGameplayTag MagnitudeSetByCallerTag;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TEnumAsByte<ECollisionChannel> OverlapObjectType = ECC_Pawn;
+
+	float GetDamageScale(float distance) const
+	{
+		const float innerRadius = Radius * InnerRadiusFraction;
+		if (distance <= innerRadius)
+		{
+			return 1.f;
+		}
+		const float alpha = FMath::Clamp((distance - innerRadius) / FMath::Max(Radius - innerRadius, UE_KINDA_SMALL_NUMBER), 0.f, 1.f);
+		return FMath::Pow(1.f - alpha, FalloffExponent);
+	}
+};
+
 USTRUCT(BlueprintType)
 struct LYRAGAME_API FInstigatorOwnerFragment : public FMassFragment
 {
@@ -53,6 +131,15 @@ struct LYRAGAME_API FInstigatorOwnerFragment : public FMassFragment
 	TWeakObjectPtr<AActor> Owner; // Damage Causer (pawn)
 };
 
+// Catalog type id the entity was spawned as, see UProjectileCatalogSubsystem. Per entity since types can share every shared fragment
+USTRUCT()
+struct LYRAGAME_API FProjectileTypeIdFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	uint16 TypeId = MAX_uint16;
+};
+
 USTRUCT(BlueprintType)
 struct LYRAGAME_API FHitInfoFragment : public FMassFragment
 {
@@ -69,6 +156,218 @@ struct LYRAGAME_API FGravityScaleFragment : public FMassSharedFragment
 	float GravityScale = 1.f;
 };
 
+UENUM(BlueprintType)
+enum class EProjectileDragModel : uint8
+{
+	// Drag coefficient doesn't change with speed
+	Constant,
+	// Standard flat-based projectile reference curve
+	G1,
+	// Long boat-tail projectile reference curve, closer to modern rifle rounds
+	G7,
+	// Sampled from a designer curve keyed on Mach number
+	Custom
+};
+
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FProjectileDragFragment : public FMassSharedFragment
+{
+	GENERATED_BODY()
+
+	// Speed of sound at sea level, in cm/s
+	static constexpr float SpeedOfSound = 34300.f;
+
+	// Deceleration per unit speed squared, the classic 0.5 * rho * Cd * A / m lumped into one number
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DragCoefficient = 0.f;
+
+	// 0 for no limit
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MaxSpeed = 0.f;
+
+	// Drag scale sampled every MachTableStep, normalised so the first entry is 1. Empty means constant drag
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<float> MachDragTable;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MachTableStep = 0.05f;
+
+	float SampleDragScale(float speed) const
+	{
+		if (MachDragTable.Num() == 0)
+		{
+			return 1.f;
+		}
+
+		const float tablePos = (speed / SpeedOfSound) / MachTableStep;
+		const int32 lowerIdx = FMath::Clamp(FMath::FloorToInt32(tablePos), 0, MachDragTable.Num() - 1);
+		const int32 upperIdx = FMath::Min(lowerIdx + 1, MachDragTable.Num() - 1);
+		return FMath::Lerp(MachDragTable[lowerIdx], MachDragTable[upperIdx], FMath::Clamp(tablePos - lowerIdx, 0.f, 1.f));
+	}
+};
+
+UENUM(BlueprintType)
+enum class EProjectileStateLayout : uint8
+{
+	// FTransformFragment, FMassVelocityFragment and FMassForceFragment, works with generic Mass processors
+	Transform,
+	// FProjectileStateFragment, full precision position
+	Compact,
+	// FProjectileRelativeStateFragment, float position relative to the world origin
+	CompactFloat
+};
+
+// Everything the movement processor needs in one fragment, 40 bytes against ~150 for the transform layout.
+// No force or scale, rotation is either derived from velocity or the packed direction
+USTRUCT()
+struct LYRAGAME_API FProjectileStateFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector GetPosition() const { return Position; }
+	void SetPosition(const FVector& position) { Position = position; }
+	FVector GetVelocity() const { return FVector(Velocity); }
+	void SetVelocity(const FVector& velocity) { Velocity = FVector3f(velocity); }
+
+	FTransform ToTransform(bool bRotationFollowsVelocity) const
+	{
+		const FVector3f direction = bRotationFollowsVelocity ? Velocity.GetSafeNormal() : UE::Projectiles::Kernel::UnpackDirection(PackedDirection);
+		return FTransform(FVector(direction).ToOrientationQuat(), Position);
+	}
+	void SetFromTransform(const FTransform& transform)
+	{
+		Position = transform.GetTranslation();
+		PackedDirection = UE::Projectiles::Kernel::PackDirection(FVector3f(transform.GetRotation().GetForwardVector()));
+	}
+
+	FVector Position = FVector::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+	uint32 PackedDirection = 0;
+};
+
+// As FProjectileStateFragment with a float position, 28 bytes. Positions are relative to the world origin and
+// shifted by the movement processor when the origin is rebased, so precision holds up in large worlds
+USTRUCT()
+struct LYRAGAME_API FProjectileRelativeStateFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector GetPosition() const { return FVector(Position); }
+	void SetPosition(const FVector& position) { Position = FVector3f(position); }
+	FVector GetVelocity() const { return FVector(Velocity); }
+	void SetVelocity(const FVector& velocity) { Velocity = FVector3f(velocity); }
+
+	FTransform ToTransform(bool bRotationFollowsVelocity) const
+	{
+		const FVector3f direction = bRotationFollowsVelocity ? Velocity.GetSafeNormal() : UE::Projectiles::Kernel::UnpackDirection(PackedDirection);
+		return FTransform(FVector(direction).ToOrientationQuat(), FVector(Position));
+	}
+	void SetFromTransform(const FTransform& transform)
+	{
+		Position = FVector3f(transform.GetTranslation());
+		PackedDirection = UE::Projectiles::Kernel::PackDirection(FVector3f(transform.GetRotation().GetForwardVector()));
+	}
+
+	FVector3f Position = FVector3f::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+	uint32 PackedDirection = 0;
+};
+
+// Projectiles launched at or above SpeedThreshold are never simulated. UMassHelpers::SpawnProjectile sweeps
+// their whole arc at spawn and the hit is applied when the projectile would have arrived.
+// Single target, server resolved damage only, the trait drops it for area damage or client confirmed hits
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FProjectileHitscanFragment : public FMassSharedFragment
+{
+	GENERATED_BODY()
+
+	// Launch speed in cm/s, 0 disables the hitscan path
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float SpeedThreshold = 0.f;
+
+	// Arc is swept this far ahead, projectiles that don't hit anything in time just vanish
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float MaxFlightTime = 1.f;
+
+	// Length of each straight segment of the arc, in seconds of flight
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.001"))
+	float ArcStepTime = 1.f / 30.f;
+
+	// Optional visual-only projectile spawned in its place, should be a ClientsOnly type without damage
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<UMassEntityConfigAsset> TracerConfig;
+};
+
+// World time the projectile was spawned, stamped by UMassHelpers. Negative for entities spawned some other way
+USTRUCT()
+struct LYRAGAME_API FProjectileSpawnTimeFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	float SpawnTime = -1.f;
+};
+
+// Per projectile type live cap, see UProjectileBudgetSubsystem
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FProjectileBudgetFragment : public FMassSharedFragment
+{
+	GENERATED_BODY()
+
+	// Most of this type alive at once, 0 for no limit other than the global one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	int32 MaxAlive = 0;
+};
+
+UENUM(BlueprintType)
+enum class EProjectileUnloadedRegionPolicy : uint8
+{
+	// Keep simulating, sweeps find nothing until the region streams in
+	Simulate,
+	// Freeze in place until the region streams in, see FProjectileDormantTag
+	Sleep,
+	Destroy
+};
+
+// What happens to projectiles that fly into a region that isn't streamed in, see UProjectileStreamingSubsystem
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FProjectileStreamingPolicyFragment : public FMassSharedFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EProjectileUnloadedRegionPolicy UnloadedRegionPolicy = EProjectileUnloadedRegionPolicy::Simulate;
+
+	// Sleepers still waiting after this many seconds are destroyed, 0 lets them sleep indefinitely
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", EditCondition = "UnloadedRegionPolicy == EProjectileUnloadedRegionPolicy::Sleep"))
+	float MaxDormantTime = 0.f;
+};
+
+// World time the projectile last went to sleep, only on types with the Sleep policy
+USTRUCT()
+struct LYRAGAME_API FProjectileDormantTimeFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	float DormantSince = 0.f;
+};
+
+// Asleep in a region that isn't streamed in, skipped by movement until UProjectileStreamingProcessor wakes it
+USTRUCT()
+struct LYRAGAME_API FProjectileDormantTag : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+// Order the movement processor walks a chunk in, so consecutive sweeps hit nearby parts of the physics BVH
+USTRUCT()
+struct LYRAGAME_API FProjectileSweepOrderChunkFragment : public FMassChunkFragment
+{
+	GENERATED_BODY()
+
+	TArray<int32> Order;
+	int32 FramesUntilResort = 0;
+};
+
 //USTRUCT(BlueprintType)
 //struct LYRAGAME_API FRicochetFragment : public FMassFragment
 //{
@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileHitApplyProcessor.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "GameFramework/Controller.h"
+#include "DrawDebugHelpers.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "Mass/LightweightProjectileSettings.h"
+#include "Mass/ProjectileHitProcessor.h"
+#include "Mass/ProjectileStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hit Apply (GameThread)"), STAT_ProjectileHitApply_GameThread, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Applied"), STAT_ProjectileHitApply_NumApplied, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Hit Apply Backlog"), STAT_ProjectileHitApply_Backlog, STATGROUP_LightweightProjectiles);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Hit Apply Max Added Latency (ms)"), STAT_ProjectileHitApply_MaxLatencyMs, STATGROUP_LightweightProjectiles);
+
+namespace ProjectileHitApply
+{
+	static bool HasHigherPriority(const FQueuedHitApply& a, const FQueuedHitApply& b)
+	{
+		return a.Priority != b.Priority ? a.Priority > b.Priority : a.QueuedTime < b.QueuedTime;
+	}
+
+	static FGameplayEffectContextHandle MakeEffectContext(const FProjectileHitApplyRecord& record)
+	{
+		FGameplayEffectContextHandle effectContext(UAbilitySystemGlobals::Get().AllocGameplayEffectContext());
+		effectContext.AddInstigator(record.Instigator.Get(), record.Owner.Get());
+		effectContext.AddHitResult(record.Hit);
+		effectContext.AddOrigin(record.Hit.TraceStart);
+		return effectContext;
+	}
+
+	static FGameplayEffectSpec MakeEffectSpec(const FProjectileHitApplyRecord& record, const UGameplayEffect* damageEffect)
+	{
+		FGameplayEffectSpec effectSpec(damageEffect, MakeEffectContext(record));
+		if (record.SetByCallerTag.IsValid())
+		{
+			effectSpec.SetSetByCallerMagnitude(record.SetByCallerTag, record.Magnitude);
+		}
+		return effectSpec;
+	}
+
+	// Sum of the effect's additive modifiers on the attribute with the set-by-caller magnitude at 0 and 1, built from a bare
+	// context as it's shared by every hit with this effect and tag
+	static FProjectileAttributeChangeEstimate EstimateAttributeChange(const UGameplayEffect& damageEffect, const FGameplayTag& setByCallerTag, const FGameplayAttribute& attribute)
+	{
+		float changes[2] = { 0.f, 0.f };
+		for (int32 magnitude = 0; magnitude < 2; ++magnitude)
+		{
+			FGameplayEffectSpec effectSpec(&damageEffect, FGameplayEffectContextHandle(UAbilitySystemGlobals::Get().AllocGameplayEffectContext()));
+			if (setByCallerTag.IsValid())
+			{
+				effectSpec.SetSetByCallerMagnitude(setByCallerTag, (float)magnitude);
+			}
+			effectSpec.CalculateModifierMagnitudes();
+
+			for (int32 modifierIdx = 0; modifierIdx < damageEffect.Modifiers.Num(); ++modifierIdx)
+			{
+				const FGameplayModifierInfo& modifier = damageEffect.Modifiers[modifierIdx];
+				if (modifier.Attribute == attribute && modifier.ModifierOp == EGameplayModOp::Additive)
+				{
+					changes[magnitude] += effectSpec.GetModifierMagnitude(modifierIdx, true);
+				}
+			}
+		}
+		return { changes[0], changes[1] - changes[0] };
+	}
+}
+
+UProjectileHitApplyProcessor::UProjectileHitApplyProcessor()
+{
+	// Paired with UProjectileHitProcessor, so runs wherever that does
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Server | EProcessorExecutionFlags::Standalone);
+
+	ExecutionOrder.ExecuteAfter.Add(UProjectileHitProcessor::StaticClass()->GetFName());
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Behavior;
+
+	// Need to talk to GAS
+	bRequiresGameThreadExecution = true;
+}
+
+void UProjectileHitApplyProcessor::Initialize(UObject& owner)
+{
+	Super::Initialize(owner);
+
+	HitSubsystem = UWorld::GetSubsystem<UProjectileHitSubsystem>(owner.GetWorld());
+}
+
+void UProjectileHitApplyProcessor::Execute(FMassEntityManager& entityManager, FMassExecutionContext& context)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileHitApply_GameThread);
+
+	if (!HitSubsystem)
+	{
+		return;
+	}
+
+	HitSubsystem->ConsumePendingHits(RecordsToApply, DebugImpacts);
+	ResolveTargets();
+
+	const ULightweightProjectileSettings* settings = GetDefault<ULightweightProjectileSettings>();
+	const bool bBudgeted = settings->MaxHitsAppliedPerFrame > 0 || settings->HitApplyBudgetMs > 0.f;
+
+	if (!bBudgeted && Backlog.Num() == 0)
+	{
+		for (const FProjectileHitApplyRecord& record : RecordsToApply)
+		{
+			ApplyRecord(record);
+		}
+	}
+	else
+	{
+		const double frameStart = FPlatformTime::Seconds();
+		for (FProjectileHitApplyRecord& record : RecordsToApply)
+		{
+			const uint8 priority = GetPriority(record, *settings);
+			Backlog.HeapPush({ MoveTemp(record), frameStart, priority }, &ProjectileHitApply::HasHigherPriority);
+		}
+
+		const int32 maxHits = settings->MaxHitsAppliedPerFrame > 0 ? settings->MaxHitsAppliedPerFrame : MAX_int32;
+		const double deadline = settings->HitApplyBudgetMs > 0.f ? frameStart + settings->HitApplyBudgetMs / 1000.0 : DBL_MAX;
+		double maxLatency = 0.0;
+
+		// Always apply at least one so a tiny budget can't stall the queue entirely
+		for (int32 numApplied = 0; Backlog.Num() > 0 && numApplied < maxHits && (numApplied == 0 || FPlatformTime::Seconds() < deadline); ++numApplied)
+		{
+			FQueuedHitApply queued;
+			Backlog.HeapPop(queued, &ProjectileHitApply::HasHigherPriority, false);
+			maxLatency = FMath::Max(maxLatency, frameStart - queued.QueuedTime);
+			ApplyRecord(queued.Record);
+		}
+
+		SET_FLOAT_STAT(STAT_ProjectileHitApply_MaxLatencyMs, maxLatency * 1000.0);
+	}
+	SET_DWORD_STAT(STAT_ProjectileHitApply_Backlog, Backlog.Num());
+
+	UWorld* world = context.GetWorld();
+	for (const FVector& impactPoint : DebugImpacts)
+	{
+		DrawDebugPoint(world, impactPoint, 10.f, FColor::Red, true);
+	}
+}
+
+float UProjectileHitApplyProcessor::GetAttributeChange(const FProjectileHitApplyRecord& record, const FGameplayAttribute& attribute)
+{
+	const UGameplayEffect* damageEffect = record.DamageEffect.Get();
+	if (damageEffect == nullptr)
+	{
+		return 0.f;
+	}
+
+	const TPair<TObjectKey<UGameplayEffect>, FGameplayTag> key(damageEffect, record.SetByCallerTag);
+	const FProjectileAttributeChangeEstimate* estimate = AttributeChangeEstimates.Find(key);
+	if (estimate == nullptr)
+	{
+		estimate = &AttributeChangeEstimates.Add(key, ProjectileHitApply::EstimateAttributeChange(*damageEffect, record.SetByCallerTag, attribute));
+	}
+	return estimate->Base + estimate->PerMagnitude * (record.SetByCallerTag.IsValid() ? record.Magnitude : 0.f);
+}
+
+uint8 UProjectileHitApplyProcessor::GetPriority(const FProjectileHitApplyRecord& record, const ULightweightProjectileSettings& settings)
+{
+	uint8 priority = 0;
+
+	const AController* controller = UProjectileHitSubsystem::GetInstigatorController(record.Instigator.Get());
+	if (controller && controller->IsPlayerController())
+	{
+		priority += 1;
+	}
+
+	const UAbilitySystemComponent* targetASC = record.TargetASC.Get();
+	if (targetASC && settings.LethalCheckAttribute.IsValid())
+	{
+		bool bFound = false;
+		const float value = targetASC->GetGameplayAttributeValue(settings.LethalCheckAttribute, bFound);
+		if (bFound && value + GetAttributeChange(record, settings.LethalCheckAttribute) <= settings.LethalThreshold)
+		{
+			priority += 2;
+		}
+	}
+
+	return priority;
+}
+
+void UProjectileHitApplyProcessor::ResolveTargets()
+{
+	// Volleys tend to hit the same few actors, so only look each one up once a frame
+	TargetASCs.Reset();
+	RecordsToApply.RemoveAllSwap([this](FProjectileHitApplyRecord& record) {
+		AActor* target = record.Target.Get();
+		if (target == nullptr)
+		{
+			return true;
+		}
+
+		UAbilitySystemComponent** targetASC = TargetASCs.Find(target);
+		if (targetASC == nullptr)
+		{
+			targetASC = &TargetASCs.Add(target, UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(target));
+		}
+		record.TargetASC = *targetASC;
+		return *targetASC == nullptr;
+	});
+}
+
+void UProjectileHitApplyProcessor::ApplyRecord(const FProjectileHitApplyRecord& record)
+{
+	UAbilitySystemComponent* hitASC = record.TargetASC.Get();
+	const UGameplayEffect* damageEffect = record.DamageEffect.Get();
+	if (hitASC == nullptr || damageEffect == nullptr)
+	{
+		// Target died or was removed between resolve and apply
+		return;
+	}
+
+	const FGameplayEffectSpec effectSpec = ProjectileHitApply::MakeEffectSpec(record, damageEffect);
+	hitASC->ApplyGameplayEffectSpecToSelf(effectSpec);
+	INC_DWORD_STAT(STAT_ProjectileHitApply_NumApplied);
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "AttributeSet.h"
+#include "UObject/ObjectKey.h"
+#include "Mass/ProjectileHitSubsystem.h"
+#include "ProjectileHitApplyProcessor.generated.h"
+
+class ULightweightProjectileSettings;
+
+// A hit waiting its turn when the apply budget is exceeded
+struct FQueuedHitApply
+{
+	FProjectileHitApplyRecord Record;
+	double QueuedTime = 0.0;
+	uint8 Priority = 0;
+};
+
+// Additive change an effect makes to the lethal check attribute, as Base + PerMagnitude * set-by-caller magnitude
+struct FProjectileAttributeChangeEstimate
+{
+	float Base = 0.f;
+	float PerMagnitude = 0.f;
+};
+
+/**
+ * Game thread half of hit processing, only applies the records UProjectileHitProcessor resolved
+ * Optionally budgeted, see ULightweightProjectileSettings, with anything over budget carried over by priority
+ */
+UCLASS()
+class LYRAGAME_API UProjectileHitApplyProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UProjectileHitApplyProcessor();
+
+protected:
+	virtual void Initialize(UObject& owner) override;
+	virtual void ConfigureQueries() override {}
+	virtual void Execute(FMassEntityManager& entityManager, FMassExecutionContext& context) override;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileHitSubsystem> HitSubsystem;
+
+	// Looks up each record's target ability system component, dropping records whose target can't take damage
+	void ResolveTargets();
+	void ApplyRecord(const FProjectileHitApplyRecord& record);
+
+	// Hits that would take the target to or below LethalThreshold first, then player instigated ones
+	uint8 GetPriority(const FProjectileHitApplyRecord& record, const ULightweightProjectileSettings& settings);
+	// Damage worked out in an execution calculation isn't visible here, so those hits only count as lethal once the target
+	// is already at the threshold. Modifiers are assumed linear in the set-by-caller magnitude, true for scalable floats and set-by-caller
+	float GetAttributeChange(const FProjectileHitApplyRecord& record, const FGameplayAttribute& attribute);
+
+	// Kept around so the swap doesn't reallocate every frame
+	TArray<FProjectileHitApplyRecord> RecordsToApply;
+	TArray<FVector> DebugImpacts;
+	TMap<AActor*, UAbilitySystemComponent*> TargetASCs;
+
+	// Building a spec per hit would cost more than applying it, so each effect and set-by-caller tag is estimated once
+	TMap<TPair<TObjectKey<UGameplayEffect>, FGameplayTag>, FProjectileAttributeChangeEstimate> AttributeChangeEstimates;
+
+	// Heap of hits carried over from previous frames, highest priority then oldest first
+	TArray<FQueuedHitApply> Backlog;
+};
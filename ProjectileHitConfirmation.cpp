@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileHitConfirmation.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/AutomationTest.h"
+#include "Net/UnrealNetwork.h"
+#include "Mass/ProjectileCatalogSubsystem.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileHitSubsystem.h"
+#include "Mass/ProjectileStats.h"
+
+namespace ProjectileHitConfirmation
+{
+	static float MaxHitAge = 1.f;
+	static FAutoConsoleVariableRef CVarMaxHitAge(
+		TEXT("Projectiles.HitConfirmation.MaxHitAge"),
+		MaxHitAge,
+		TEXT("Client reported hits older than this many seconds are rejected by the server"));
+
+	static float MaxClockError = 0.25f;
+	static FAutoConsoleVariableRef CVarMaxClockError(
+		TEXT("Projectiles.HitConfirmation.MaxClockError"),
+		MaxClockError,
+		TEXT("How far ahead of the server's time a client reported hit may be, in seconds"));
+
+	static float MaxShotLifetime = 10.f;
+	static FAutoConsoleVariableRef CVarMaxShotLifetime(
+		TEXT("Projectiles.HitConfirmation.MaxShotLifetime"),
+		MaxShotLifetime,
+		TEXT("How long after the server spawned a shot a client may still report it hitting something, in seconds"));
+
+	static float ImpactTolerance = 100.f;
+	static FAutoConsoleVariableRef CVarImpactTolerance(
+		TEXT("Projectiles.HitConfirmation.ImpactTolerance"),
+		ImpactTolerance,
+		TEXT("How far outside the target's bounds a client reported impact may be, in cm"));
+
+	static float MaxShotAngle = 10.f;
+	static FAutoConsoleVariableRef CVarMaxShotAngle(
+		TEXT("Projectiles.HitConfirmation.MaxShotAngle"),
+		MaxShotAngle,
+		TEXT("Half angle of the cone around a shot's initial velocity a client reported impact has to lie in, in degrees. Gravity drop is allowed on top"));
+
+	// Impacts relative to the target quantized to 1/10th cm
+	static constexpr int32 ImpactScale = 10;
+	static constexpr int32 ImpactMaxBits = 24;
+}
+
+bool FProjectileHitBatch::NetSerialize(FArchive& ar, UPackageMap* map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint32 numHits = FMath::Min(Hits.Num(), MaxHitsPerBatch);
+	ar.SerializeIntPacked(numHits);
+	if (ar.IsLoading())
+	{
+		if (numHits > (uint32)MaxHitsPerBatch)
+		{
+			bOutSuccess = false;
+			return false;
+		}
+		Hits.SetNum(numHits);
+	}
+
+	// Times are sent as milliseconds after the first hit in the batch
+	double baseTime = numHits > 0 ? Hits[0].Time : 0.0;
+	ar << baseTime;
+
+	for (uint32 hitIdx = 0; hitIdx < numHits; ++hitIdx)
+	{
+		FProjectileConfirmedHit& hit = Hits[hitIdx];
+
+		ar.SerializeIntPacked(hit.EntityId);
+
+		uint32 typeId = hit.TypeId;
+		ar.SerializeIntPacked(typeId);
+		hit.TypeId = (uint16)typeId;
+
+		// Without a package map (e.g. measuring offline) there's no way to reference the target
+		UObject* target = hit.Target.Get();
+		if (map)
+		{
+			bOutSuccess &= map->SerializeObject(ar, AActor::StaticClass(), target);
+		}
+		if (ar.IsLoading())
+		{
+			hit.Target = Cast<AActor>(target);
+		}
+
+		bOutSuccess &= SerializePackedVector<ProjectileHitConfirmation::ImpactScale, ProjectileHitConfirmation::ImpactMaxBits>(hit.RelativeImpactPoint, ar);
+
+		uint16 timeOffsetMs = (uint16)FMath::Clamp(FMath::RoundToInt((hit.Time - baseTime) * 1000.0), 0, (int32)MAX_uint16);
+		ar << timeOffsetMs;
+		if (ar.IsLoading())
+		{
+			hit.Time = baseTime + timeOffsetMs / 1000.0;
+		}
+	}
+
+	return true;
+}
+
+UProjectileHitConfirmationComponent::UProjectileHitConfirmationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+	SetIsReplicatedByDefault(true);
+}
+
+void UProjectileHitConfirmationComponent::TickComponent(float deltaTime, ELevelTick tickType, FActorComponentTickFunction* thisTickFunction)
+{
+	Super::TickComponent(deltaTime, tickType, thisTickFunction);
+
+	const APlayerController* pc = GetOwner<APlayerController>();
+	if (pc == nullptr || !pc->IsLocalController() || GetOwnerRole() == ROLE_Authority)
+	{
+		// Only remote clients send anything, the server resolves its own players' hits
+		return;
+	}
+
+	UWorld* world = GetWorld();
+	UProjectileHitSubsystem* hitSS = UWorld::GetSubsystem<UProjectileHitSubsystem>(world);
+	if (hitSS == nullptr)
+	{
+		return;
+	}
+
+	// Collect every frame, but only send once per net update
+	hitSS->ConsumeClientHits(PendingBatch.Hits);
+	if (PendingBatch.Hits.Num() == 0 || world->GetTimeSeconds() < NextSendTime)
+	{
+		return;
+	}
+
+	NextSendTime = world->GetTimeSeconds() + 1.0 / FMath::Max(pc->NetUpdateFrequency, 1.f);
+
+	while (PendingBatch.Hits.Num() > 0)
+	{
+		const int32 numToSend = FMath::Min(PendingBatch.Hits.Num(), FProjectileHitBatch::MaxHitsPerBatch);
+		if (numToSend == PendingBatch.Hits.Num())
+		{
+			ServerConfirmHits(PendingBatch);
+			PendingBatch.Hits.Reset();
+		}
+		else
+		{
+			FProjectileHitBatch overflowBatch;
+			overflowBatch.Hits.Append(PendingBatch.Hits.GetData(), numToSend);
+			ServerConfirmHits(overflowBatch);
+			PendingBatch.Hits.RemoveAt(0, numToSend, false);
+		}
+	}
+}
+
+bool UProjectileHitConfirmationComponent::ValidateHit(const FProjectileConfirmedHit& hit, double serverTime) const
+{
+	const AActor* target = hit.Target.Get();
+	if (target == nullptr)
+	{
+		return false;
+	}
+
+	if (serverTime - hit.Time > ProjectileHitConfirmation::MaxHitAge || hit.Time - serverTime > ProjectileHitConfirmation::MaxClockError)
+	{
+		return false;
+	}
+
+	FVector origin, extent;
+	target->GetActorBounds(true, origin, extent);
+	const FVector impactPoint = target->GetActorLocation() + hit.RelativeImpactPoint;
+	return FVector::DistSquared(impactPoint, origin) <= FMath::Square(extent.Size() + ProjectileHitConfirmation::ImpactTolerance);
+}
+
+void UProjectileHitConfirmationComponent::RegisterShot(const UWorld& world, const AActor* instigator, uint16 typeId, const FVector& origin, const FVector& velocity)
+{
+	if (world.GetNetMode() == NM_Client || world.GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	const APlayerController* pc = Cast<APlayerController>(UProjectileHitSubsystem::GetInstigatorController(instigator));
+	if (pc == nullptr || pc->IsLocalController())
+	{
+		return;
+	}
+
+	const UProjectileCatalogSubsystem* catalogSS = world.GetSubsystem<UProjectileCatalogSubsystem>();
+	const FMassEntityTemplate* entityTemplate = catalogSS ? catalogSS->GetTemplate(typeId) : nullptr;
+	if (entityTemplate == nullptr || !entityTemplate->GetCompositionDescriptor().Tags.Contains<FProjectileClientConfirmedHitsTag>())
+	{
+		return;
+	}
+
+	if (UProjectileHitConfirmationComponent* confirmation = pc->FindComponentByClass<UProjectileHitConfirmationComponent>())
+	{
+		const double now = world.GetTimeSeconds();
+
+		// Shots which never hit anything are forgotten once no report could match them anymore
+		TArray<FConfirmableShot>& shots = confirmation->ConfirmableShots;
+		int32 numExpired = 0;
+		while (numExpired < shots.Num() && now - shots[numExpired].SpawnTime > ProjectileHitConfirmation::MaxShotLifetime)
+		{
+			++numExpired;
+		}
+		shots.RemoveAt(0, numExpired, false);
+
+		confirmation->ConfirmableShots.Add({ typeId, now, origin, velocity });
+	}
+}
+
+bool UProjectileHitConfirmationComponent::CanShotReach(const FConfirmableShot& shot, double hitTime, const FVector& impactPoint) const
+{
+	const double elapsed = hitTime - shot.SpawnTime;
+	if (elapsed < -ProjectileHitConfirmation::MaxClockError || elapsed > ProjectileHitConfirmation::MaxShotLifetime)
+	{
+		return false;
+	}
+
+	// Drag only ever slows a projectile down, so straight line travel at the spawn speed plus gravity drop bounds where it can be
+	const double flightTime = FMath::Max(elapsed, 0.0) + ProjectileHitConfirmation::MaxClockError;
+	const double gravityDrop = 0.5 * FMath::Abs(GetWorld()->GetGravityZ()) * flightTime * flightTime;
+	const double tolerance = ProjectileHitConfirmation::ImpactTolerance + gravityDrop;
+
+	const FVector offset = impactPoint - shot.Origin;
+	const double speed = shot.Velocity.Size();
+	if (offset.Size() > speed * flightTime + tolerance)
+	{
+		return false;
+	}
+
+	// Distance off the line of fire, allowing for the cone widening and the drop
+	const FVector direction = speed > UE_KINDA_SMALL_NUMBER ? shot.Velocity / speed : FVector::ZeroVector;
+	const double along = FVector::DotProduct(offset, direction);
+	if (along < -tolerance)
+	{
+		return false;
+	}
+	const double lateral = (offset - along * direction).Size();
+	return lateral <= FMath::Max(along, 0.0) * FMath::Tan(FMath::DegreesToRadians((double)ProjectileHitConfirmation::MaxShotAngle)) + tolerance;
+}
+
+bool UProjectileHitConfirmationComponent::ConsumeShot(uint16 typeId, double hitTime, const FVector& impactPoint)
+{
+	const int32 shotIdx = ConfirmableShots.IndexOfByPredicate([this, typeId, hitTime, &impactPoint](const FConfirmableShot& shot)
+	{
+		return shot.TypeId == typeId && CanShotReach(shot, hitTime, impactPoint);
+	});
+	if (shotIdx == INDEX_NONE)
+	{
+		return false;
+	}
+
+	ConfirmableShots.RemoveAt(shotIdx, 1, false);
+	return true;
+}
+
+void UProjectileHitConfirmationComponent::ServerConfirmHits_Implementation(const FProjectileHitBatch& batch)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileHitConfirmation_ServerConfirmHits);
+
+	UWorld* world = GetWorld();
+	UProjectileHitSubsystem* hitSS = UWorld::GetSubsystem<UProjectileHitSubsystem>(world);
+	const UProjectileCatalogSubsystem* catalogSS = UWorld::GetSubsystem<UProjectileCatalogSubsystem>(world);
+	APlayerController* pc = GetOwner<APlayerController>();
+	if (hitSS == nullptr || catalogSS == nullptr || pc == nullptr)
+	{
+		return;
+	}
+
+	APawn* pawn = pc->GetPawn();
+	const double serverTime = world->GetTimeSeconds();
+
+	for (const FProjectileConfirmedHit& confirmedHit : batch.Hits)
+	{
+		// Only types which opted into client confirmation can be reported, otherwise clients could pick any damage they like
+		const FMassEntityTemplate* entityTemplate = catalogSS->GetTemplate(confirmedHit.TypeId);
+		const FGEDamageFragment* damageFragment = catalogSS->GetDamageFragment(confirmedHit.TypeId);
+		if (entityTemplate == nullptr || damageFragment == nullptr
+			|| !entityTemplate->GetCompositionDescriptor().Tags.Contains<FProjectileClientConfirmedHitsTag>())
+		{
+			UE_LOG(LogLightweightProjectiles, Warning, TEXT("%s reported a hit with projectile type %u which doesn't allow client confirmed hits"), *pc->GetName(), confirmedHit.TypeId);
+			continue;
+		}
+
+		// Every reported hit has to belong to a shot the server saw this player fire, and lie where that shot could have gone
+		if (!ValidateHit(confirmedHit, serverTime))
+		{
+			UE_LOG(LogLightweightProjectiles, Verbose, TEXT("Rejected client hit from %s (entity %u)"), *pc->GetName(), confirmedHit.EntityId);
+			continue;
+		}
+
+		AActor* target = confirmedHit.Target.Get();
+		const FVector impactPoint = target->GetActorLocation() + confirmedHit.RelativeImpactPoint;
+		if (!ConsumeShot(confirmedHit.TypeId, confirmedHit.Time, impactPoint))
+		{
+			UE_LOG(LogLightweightProjectiles, Verbose, TEXT("Rejected client hit from %s (entity %u), no shot could reach it"), *pc->GetName(), confirmedHit.EntityId);
+			continue;
+		}
+
+		FHitResult hit;
+		hit.bBlockingHit = true;
+		hit.HitObjectHandle = FActorInstanceHandle(target);
+		hit.ImpactPoint = impactPoint;
+		hit.Location = hit.ImpactPoint;
+		hit.TraceStart = pawn ? pawn->GetActorLocation() : hit.ImpactPoint;
+		hit.TraceEnd = hit.ImpactPoint;
+		hit.ImpactNormal = (hit.TraceStart - hit.ImpactPoint).GetSafeNormal();
+		hit.Normal = hit.ImpactNormal;
+
+		TSubclassOf<UGameplayEffect> damageEffect = damageFragment->DamageEffect.Get();
+		hitSS->QueueHit(hit, pc, pawn, damageEffect.GetDefaultObject());
+	}
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileHitBatchLoopbackTest, "Projectiles.HitConfirmation.Loopback",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileHitBatchLoopbackTest::RunTest(const FString& parameters)
+{
+	// Targets need a connection's package map, everything else is measured without one
+	static constexpr double MaxBytesPerHit = 16.0;
+	const double maxImpactError = 0.5 / ProjectileHitConfirmation::ImpactScale * UE_SQRT_3;
+	const double maxTimeError = 0.0005 + UE_DOUBLE_KINDA_SMALL_NUMBER;
+
+	FRandomStream random(0x41741);
+	FProjectileHitBatch sentBatch;
+	const double baseTime = 1234.5;
+	for (int32 hitIdx = 0; hitIdx < FProjectileHitBatch::MaxHitsPerBatch; ++hitIdx)
+	{
+		FProjectileConfirmedHit& hit = sentBatch.Hits.AddDefaulted_GetRef();
+		hit.EntityId = random.RandRange(0, 100000);
+		hit.TypeId = (uint16)random.RandRange(0, 15);
+		hit.RelativeImpactPoint = random.GetUnitVector() * random.FRandRange(0.0, 100.0);
+		hit.Time = baseTime + hitIdx * (1.0 / 60.0) + random.FRandRange(0.0, 0.001);
+	}
+
+	FNetBitWriter writer(nullptr, FProjectileHitBatch::MaxHitsPerBatch * 256);
+	bool bSuccess = false;
+	sentBatch.NetSerialize(writer, nullptr, bSuccess);
+	TestTrue(TEXT("Batch writes"), bSuccess && !writer.IsError());
+
+	FNetBitReader reader(nullptr, writer.GetData(), writer.GetNumBits());
+	FProjectileHitBatch receivedBatch;
+	receivedBatch.NetSerialize(reader, nullptr, bSuccess);
+	TestTrue(TEXT("Batch reads"), bSuccess && !reader.IsError());
+	if (!TestEqual(TEXT("Hit count round trips"), receivedBatch.Hits.Num(), sentBatch.Hits.Num()))
+	{
+		return false;
+	}
+
+	for (int32 hitIdx = 0; hitIdx < sentBatch.Hits.Num(); ++hitIdx)
+	{
+		const FProjectileConfirmedHit& sent = sentBatch.Hits[hitIdx];
+		const FProjectileConfirmedHit& received = receivedBatch.Hits[hitIdx];
+		TestEqual(TEXT("Entity id round trips"), received.EntityId, sent.EntityId);
+		TestEqual(TEXT("Type id round trips"), received.TypeId, sent.TypeId);
+		TestTrue(FString::Printf(TEXT("Impact %d within quantization"), hitIdx), FVector::Dist(sent.RelativeImpactPoint, received.RelativeImpactPoint) <= maxImpactError);
+		TestTrue(FString::Printf(TEXT("Time %d within a millisecond step"), hitIdx), FMath::Abs(sent.Time - received.Time) <= maxTimeError);
+	}
+
+	const double bytesPerHit = writer.GetNumBits() / 8.0 / sentBatch.Hits.Num();
+	AddInfo(FString::Printf(TEXT("%d hits at %.2f bytes/hit"), sentBatch.Hits.Num(), bytesPerHit));
+	TestTrue(FString::Printf(TEXT("%.2f bytes/hit is within %.0f"), bytesPerHit, MaxBytesPerHit), bytesPerHit <= MaxBytesPerHit);
+
+	// A sender never writes more than a batch's worth, and a receiver refuses a count over it before reading any hits
+	FProjectileHitBatch oversizedBatch = sentBatch;
+	oversizedBatch.Hits.Add(sentBatch.Hits[0]);
+	FNetBitWriter clampedWriter(nullptr, (FProjectileHitBatch::MaxHitsPerBatch + 1) * 256);
+	oversizedBatch.NetSerialize(clampedWriter, nullptr, bSuccess);
+	FNetBitReader clampedReader(nullptr, clampedWriter.GetData(), clampedWriter.GetNumBits());
+	FProjectileHitBatch clampedBatch;
+	clampedBatch.NetSerialize(clampedReader, nullptr, bSuccess);
+	TestEqual(TEXT("Oversized batch is clamped on send"), clampedBatch.Hits.Num(), FProjectileHitBatch::MaxHitsPerBatch);
+
+	FNetBitWriter forgedWriter(nullptr, 64);
+	uint32 forgedNumHits = FProjectileHitBatch::MaxHitsPerBatch + 1;
+	forgedWriter.SerializeIntPacked(forgedNumHits);
+	FNetBitReader forgedReader(nullptr, forgedWriter.GetData(), forgedWriter.GetNumBits());
+	FProjectileHitBatch forgedBatch;
+	const bool bForgedRead = forgedBatch.NetSerialize(forgedReader, nullptr, bSuccess);
+	TestFalse(TEXT("Oversized batch is rejected on receive"), bForgedRead || bSuccess);
+	TestEqual(TEXT("Rejected batch holds no hits"), forgedBatch.Hits.Num(), 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ProjectileHitConfirmation.generated.h"
+
+// One client-side projectile hit, quantized on the wire
+USTRUCT()
+struct FProjectileConfirmedHit
+{
+	GENERATED_BODY()
+
+	// Client entity index, only used to tell hits apart in logs
+	uint32 EntityId = 0;
+	uint16 TypeId = 0;
+	TWeakObjectPtr<AActor> Target;
+	// Relative to the target's location at the time of the hit, so it survives the target moving before the server sees it
+	FVector RelativeImpactPoint = FVector::ZeroVector;
+	// Server world time of the hit, as estimated by the client
+	double Time = 0.0;
+};
+
+// All hits a client made since its last net update, sent in one RPC
+USTRUCT()
+struct FProjectileHitBatch
+{
+	GENERATED_BODY()
+
+	static constexpr int32 MaxHitsPerBatch = 256;
+
+	TArray<FProjectileConfirmedHit> Hits;
+
+	bool NetSerialize(FArchive& ar, UPackageMap* map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FProjectileHitBatch> : public TStructOpsTypeTraitsBase2<FProjectileHitBatch>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ * Lives on the player controller. The owning client sends its projectile hits up once per net update,
+ * the server sanity checks them and feeds them into the normal hit apply path
+ */
+UCLASS(ClassGroup = (Projectiles), meta = (BlueprintSpawnableComponent))
+class LYRAGAME_API UProjectileHitConfirmationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UProjectileHitConfirmationComponent();
+
+	virtual void TickComponent(float deltaTime, ELevelTick tickType, FActorComponentTickFunction* thisTickFunction) override;
+
+	// Server side, called for every projectile spawned with an instigator. Remembers shots by remote players of types
+	// using client confirmed hits, each one can be confirmed as a hit at most once and only somewhere it could have reached
+	static void RegisterShot(const UWorld& world, const AActor* instigator, uint16 typeId, const FVector& origin, const FVector& velocity);
+
+protected:
+	// Reliable, a dropped batch would silently lose the damage
+	UFUNCTION(Server, Reliable)
+	void ServerConfirmHits(const FProjectileHitBatch& batch);
+
+	bool ValidateHit(const FProjectileConfirmedHit& hit, double serverTime) const;
+	// Finds and removes the server side shot a reported hit came from
+	bool ConsumeShot(uint16 typeId, double hitTime, const FVector& impactPoint);
+
+	struct FConfirmableShot
+	{
+		uint16 TypeId;
+		double SpawnTime;
+		FVector Origin;
+		FVector Velocity;
+	};
+	bool CanShotReach(const FConfirmableShot& shot, double hitTime, const FVector& impactPoint) const;
+	// Server only, oldest first
+	TArray<FConfirmableShot> ConfirmableShots;
+
+	FProjectileHitBatch PendingBatch;
+	double NextSendTime = 0.0;
+};
@@ -2,26 +2,130 @@
 
 
 #include "Mass/ProjectileHitProcessor.h"
-#include "AbilitySystemGlobals.h"
-#include "AbilitySystemComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
 #include "MassCommonFragments.h"
 #include "MassCommonTypes.h"
 #include "MassCommonUtils.h"
 #include "MassExecutionContext.h"
 #include "MassMovementFragments.h"
 #include "MassSignalSubsystem.h"
+#include "Misc/AutomationTest.h"
 #include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileHitSubsystem.h"
+#include "Mass/ProjectileMovementKernel.h"
 #include "Mass/ProjectileMovementProcessor.h"
+#include "Mass/ProjectileStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hit Resolve"), STAT_ProjectileHitResolve, STATGROUP_LightweightProjectiles);
+DECLARE_CYCLE_STAT(TEXT("Area Damage Resolve"), STAT_ProjectileAreaDamageResolve, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Area Damage Overlaps"), STAT_ProjectileAreaDamage_NumOverlaps, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Area Damage Explosions"), STAT_ProjectileAreaDamage_NumExplosions, STATGROUP_LightweightProjectiles);
+
+namespace ProjectileHitProcessor
+{
+	static float MinClusterCellSize = 1000.f;
+	static FAutoConsoleVariableRef CVarMinClusterCellSize(
+		TEXT("Projectiles.AreaDamage.MinClusterCellSize"),
+		MinClusterCellSize,
+		TEXT("Smallest grid cell explosions are clustered into, each occupied cell costs one overlap query. Cells are at least twice the largest blast radius"));
+
+	// A cluster overlap result with what every blast in the cluster needs read once
+	struct FAreaDamageOverlap
+	{
+		AActor* Actor;
+		UPrimitiveComponent* Component;
+		FBox Bounds;
+		ECollisionChannel ObjectType;
+	};
+
+	struct FTargetKey
+	{
+		AActor* Target;
+		const FProjectileAreaDamageFragment* AreaDamage;
+		AActor* Instigator;
+
+		bool operator==(const FTargetKey& other) const
+		{
+			return Target == other.Target && AreaDamage == other.AreaDamage && Instigator == other.Instigator;
+		}
+		friend uint32 GetTypeHash(const FTargetKey& key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(key.Target), GetTypeHash(key.AreaDamage)), GetTypeHash(key.Instigator));
+		}
+	};
+
+	// Summed over every blast catching the same target with the same area damage and instigator, the hit is the first blast's
+	struct FTargetDamage
+	{
+		UPrimitiveComponent* Component = nullptr;
+		FVector Origin = FVector::ZeroVector;
+		FVector ImpactPoint = FVector::ZeroVector;
+		double Distance = 0.0;
+		TWeakObjectPtr<AActor> Owner;
+		float DamageScale = 0.f;
+	};
+
+	using FBlastTargets = TMap<AActor*, TPair<const FAreaDamageOverlap*, double>, TInlineSetAllocator<16>>;
+
+	// Adds one blast's damage to every actor in range, an actor is only damaged once per blast from its closest component
+	// however many components it has or how often the overlap reported them
+	static void AccumulateBlast(const FProjectileExplosion& explosion, TConstArrayView<FAreaDamageOverlap> overlaps, FBlastTargets& blastTargets, TMap<FTargetKey, FTargetDamage>& targets)
+	{
+		const FProjectileAreaDamageFragment& areaDamage = *explosion.AreaDamage;
+		const double radiusSquared = FMath::Square((double)areaDamage.Radius);
+
+		blastTargets.Reset();
+		for (const FAreaDamageOverlap& overlap : overlaps)
+		{
+			if (overlap.ObjectType != areaDamage.OverlapObjectType)
+			{
+				continue;
+			}
+
+			const double distanceSquared = overlap.Bounds.ComputeSquaredDistanceToPoint(explosion.Location);
+			if (distanceSquared > radiusSquared)
+			{
+				continue;
+			}
+
+			TPair<const FAreaDamageOverlap*, double>* closest = blastTargets.Find(overlap.Actor);
+			if (closest == nullptr || distanceSquared < closest->Value)
+			{
+				blastTargets.Add(overlap.Actor, TPair<const FAreaDamageOverlap*, double>(&overlap, distanceSquared));
+			}
+		}
+
+		for (const TPair<AActor*, TPair<const FAreaDamageOverlap*, double>>& blastTarget : blastTargets)
+		{
+			const double distance = FMath::Sqrt(blastTarget.Value.Value);
+			const FTargetKey targetKey{ blastTarget.Key, explosion.AreaDamage, explosion.Instigator.Get() };
+			FTargetDamage& target = targets.FindOrAdd(targetKey);
+			if (target.DamageScale == 0.f)
+			{
+				target.Component = blastTarget.Value.Key->Component;
+				target.Origin = explosion.Location;
+				target.ImpactPoint = blastTarget.Value.Key->Bounds.GetClosestPointTo(explosion.Location);
+				target.Distance = distance;
+				target.Owner = explosion.Owner;
+			}
+			target.DamageScale += areaDamage.GetDamageScale((float)distance);
+		}
+	}
+}
 
 UProjectileHitProcessor::UProjectileHitProcessor()
 {
-	ExecutionFlags = (int32)EProcessorExecutionFlags::All;
+	// Damage is server authoritative, clients retire their projectiles in UProjectileClientHitProcessor
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Server | EProcessorExecutionFlags::Standalone);
 
 	ExecutionOrder.ExecuteAfter.Add(UProjectileMovementProcessor::StaticClass()->GetFName());
 	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Behavior;
 
-	// Need to talk to GAS
-	bRequiresGameThreadExecution = true;
+	// Only resolves targets and builds apply records, UProjectileHitApplyProcessor talks to GAS on the game thread
+	bRequiresGameThreadExecution = false;
 }
 
 void UProjectileHitProcessor::Initialize(UObject& owner)
@@ -30,6 +134,8 @@ void UProjectileHitProcessor::Initialize(UObject& owner)
 
 	UMassSignalSubsystem* signalSS = UWorld::GetSubsystem<UMassSignalSubsystem>(owner.GetWorld());
 	SubscribeToSignal(*signalSS, UProjectileMovementProcessor::ProjectileEntityHitSignal);
+
+	HitSubsystem = UWorld::GetSubsystem<UProjectileHitSubsystem>(owner.GetWorld());
 }
 
 void UProjectileHitProcessor::ConfigureQueries()
@@ -38,6 +144,14 @@ void UProjectileHitProcessor::ConfigureQueries()
 	EntityQuery.AddConstSharedRequirement<FGEDamageFragment>(EMassFragmentPresence::All);
 	EntityQuery.AddRequirement<FInstigatorOwnerFragment>(EMassFragmentAccess::ReadOnly);
 	EntityQuery.AddRequirement<FHitInfoFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddConstSharedRequirement<FProjectileAreaDamageFragment>(EMassFragmentPresence::Optional);
+	// Standalone and listen servers simulate cosmetic projectiles too, those never deal damage
+	EntityQuery.AddTagRequirement<FProjectileCosmeticTag>(EMassFragmentPresence::None);
+
+	// Cosmetic Query, just retired on hit
+	CosmeticQuery.AddRequirement<FHitInfoFragment>(EMassFragmentAccess::ReadOnly);
+	CosmeticQuery.AddTagRequirement<FProjectileCosmeticTag>(EMassFragmentPresence::All);
+	CosmeticQuery.RegisterWithProcessor(*this);
 
 	// TODO: Ricochet Query
 }
@@ -45,48 +159,253 @@ void UProjectileHitProcessor::ConfigureQueries()
 void UProjectileHitProcessor::SignalEntities(FMassEntityManager& entityManager, FMassExecutionContext& context, FMassSignalNameLookup& entitysignals)
 {
 	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileHitProcessor_SignalEntities);
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileHitResolve);
+
+	if (!HitSubsystem)
+	{
+		return;
+	}
 
 	EntityQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
 		QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileHitProcessor_ProcessChunk);
 
 		const int32 numEntities = context.GetNumEntities();
-		UWorld* world = context.GetWorld();
 
 		// Shared frags
 		const FGEDamageFragment& damageFrag = context.GetConstSharedFragment<FGEDamageFragment>();
 		TSubclassOf<UGameplayEffect> damageEffect = damageFrag.DamageEffect.Get();
+		const UGameplayEffect* damageEffectCDO = damageEffect.GetDefaultObject();
 
 		// Per-entity frags
 		TArrayView<const FInstigatorOwnerFragment> instigatorOwnerView = context.GetFragmentView<FInstigatorOwnerFragment>();
 		TArrayView<const FHitInfoFragment> hitInfos = context.GetFragmentView<FHitInfoFragment>();
 
+		const bool bClientConfirmedHits = context.DoesArchetypeHaveTag<FProjectileClientConfirmedHitsTag>();
+		const FProjectileAreaDamageFragment* areaDamage = context.GetConstSharedFragmentPtr<FProjectileAreaDamageFragment>();
+
 		for (int32 idx = 0; idx < numEntities; ++idx)
 		{
 			const FInstigatorOwnerFragment& instigatorOwner = instigatorOwnerView[idx];
 			const FHitInfoFragment& hitInfo = hitInfos[idx];
-			const FHitResult& hit = hitInfo.HitInfo;
 
-			if (AActor* hitActor = hit.GetActor())
+			// Area damage stays server resolved even when direct hits are client confirmed
+			if (areaDamage)
 			{
-				// Long term, this should probably feed data into an ability which can then send it via target data to the server for confirmation
+				FrameExplosions.Add({ hitInfo.HitInfo.Location, instigatorOwner.InstigatorActor, instigatorOwner.Owner, areaDamage });
+			}
 
-				if (UAbilitySystemComponent* hitASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(hitActor))
+			if (bClientConfirmedHits)
+			{
+				// Remote players report these themselves through UProjectileHitConfirmationComponent
+				const AController* controller = UProjectileHitSubsystem::GetInstigatorController(instigatorOwner.InstigatorActor.Get());
+				if (controller && controller->IsPlayerController() && !controller->IsLocalController())
 				{
-					FGameplayEffectContextHandle contextHandle(UAbilitySystemGlobals::Get().AllocGameplayEffectContext());
-					FGameplayEffectContext* effectContext = contextHandle.Get();
-					effectContext->AddInstigator(instigatorOwner.InstigatorActor.Get(), instigatorOwner.Owner.Get());
-					effectContext->AddHitResult(hit);
-					effectContext->AddOrigin(hit.TraceStart);
-
-					FGameplayEffectSpec effectSpec(damageEffect.GetDefaultObject(), contextHandle);
-					hitASC->ApplyGameplayEffectSpecToSelf(effectSpec);
+					continue;
 				}
-
-				DrawDebugPoint(world, hit.ImpactPoint, 10.f, FColor::Red, true);
 			}
+
+			// Long term, this should probably feed data into an ability which can then send it via target data to the server for confirmation
+			HitSubsystem->QueueHit(hitInfo.HitInfo, instigatorOwner.InstigatorActor.Get(), instigatorOwner.Owner.Get(), damageEffectCDO);
 		}
 
 		// TODO: Filter out entities which can bounce/ricochet
 		entityManager.Defer().DestroyEntities(context.GetEntities());
 	});
+
+	CosmeticQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		entityManager.Defer().DestroyEntities(context.GetEntities());
+	});
+
+	if (FrameExplosions.Num() > 0)
+	{
+		ResolveAreaDamage(*context.GetWorld());
+		FrameExplosions.Reset();
+	}
 }
+
+void UProjectileHitProcessor::ResolveAreaDamage(UWorld& world)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileAreaDamageResolve);
+	INC_DWORD_STAT_BY(STAT_ProjectileAreaDamage_NumExplosions, FrameExplosions.Num());
+
+	float maxRadius = 0.f;
+	for (const FProjectileExplosion& explosion : FrameExplosions)
+	{
+		maxRadius = FMath::Max(maxRadius, explosion.AreaDamage->Radius);
+	}
+
+	// Morton order puts explosions sharing a cell next to each other, so each run of equal keys is one cluster
+	const float cellSize = FMath::Max(ProjectileHitProcessor::MinClusterCellSize, maxRadius * 2.f);
+	TArray<uint64, TInlineAllocator<64>> cellKeys;
+	cellKeys.SetNumUninitialized(FrameExplosions.Num());
+	for (int32 idx = 0; idx < FrameExplosions.Num(); ++idx)
+	{
+		cellKeys[idx] = UE::Projectiles::Kernel::MortonKey(FrameExplosions[idx].Location, cellSize);
+	}
+	TArray<int32, TInlineAllocator<64>> order;
+	order.SetNumUninitialized(FrameExplosions.Num());
+	for (int32 idx = 0; idx < order.Num(); ++idx)
+	{
+		order[idx] = idx;
+	}
+	Algo::SortBy(order, [&cellKeys](int32 idx) { return cellKeys[idx]; });
+
+	TMap<ProjectileHitProcessor::FTargetKey, ProjectileHitProcessor::FTargetDamage> targets;
+	TArray<FOverlapResult> overlaps;
+	TArray<ProjectileHitProcessor::FAreaDamageOverlap> clusterOverlaps;
+	ProjectileHitProcessor::FBlastTargets blastTargets;
+
+	FCollisionQueryParams queryParams(SCENE_QUERY_STAT(ProjectileAreaDamage), false);
+
+	for (int32 runStart = 0; runStart < order.Num();)
+	{
+		int32 runEnd = runStart + 1;
+		while (runEnd < order.Num() && cellKeys[order[runEnd]] == cellKeys[order[runStart]])
+		{
+			++runEnd;
+		}
+
+		FBox clusterBounds(ForceInit);
+		FCollisionObjectQueryParams objectParams;
+		for (int32 orderIdx = runStart; orderIdx < runEnd; ++orderIdx)
+		{
+			const FProjectileExplosion& explosion = FrameExplosions[order[orderIdx]];
+			clusterBounds += FBox::BuildAABB(explosion.Location, FVector(explosion.AreaDamage->Radius));
+			objectParams.AddObjectTypesToQuery(explosion.AreaDamage->OverlapObjectType);
+		}
+
+		overlaps.Reset();
+		INC_DWORD_STAT(STAT_ProjectileAreaDamage_NumOverlaps);
+		world.OverlapMultiByObjectType(overlaps, clusterBounds.GetCenter(), FQuat::Identity, objectParams, FCollisionShape::MakeBox(clusterBounds.GetExtent()), queryParams);
+
+		clusterOverlaps.Reset();
+		for (const FOverlapResult& overlap : overlaps)
+		{
+			UPrimitiveComponent* component = overlap.GetComponent();
+			AActor* actor = overlap.GetActor();
+			if (component && actor)
+			{
+				clusterOverlaps.Add({ actor, component, component->Bounds.GetBox(), component->GetCollisionObjectType() });
+			}
+		}
+
+		for (int32 orderIdx = runStart; orderIdx < runEnd; ++orderIdx)
+		{
+			ProjectileHitProcessor::AccumulateBlast(FrameExplosions[order[orderIdx]], clusterOverlaps, blastTargets, targets);
+		}
+
+		runStart = runEnd;
+	}
+
+	for (const TPair<ProjectileHitProcessor::FTargetKey, ProjectileHitProcessor::FTargetDamage>& target : targets)
+	{
+		const FProjectileAreaDamageFragment& areaDamage = *target.Key.AreaDamage;
+		TSubclassOf<UGameplayEffect> damageEffect = areaDamage.DamageEffect.Get();
+		if (damageEffect == nullptr || target.Value.DamageScale <= 0.f)
+		{
+			continue;
+		}
+
+		const ProjectileHitProcessor::FTargetDamage& targetDamage = target.Value;
+		FHitResult hit(target.Key.Target, targetDamage.Component, targetDamage.ImpactPoint, (targetDamage.ImpactPoint - targetDamage.Origin).GetSafeNormal());
+		hit.ImpactPoint = targetDamage.ImpactPoint;
+		hit.TraceStart = targetDamage.Origin;
+		hit.Distance = targetDamage.Distance;
+
+		HitSubsystem->QueueHit(hit, target.Key.Instigator, targetDamage.Owner.Get(), damageEffect.GetDefaultObject(),
+			areaDamage.MagnitudeSetByCallerTag, targetDamage.DamageScale);
+	}
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileAreaDamageFalloffTest, "Projectiles.AreaDamage.Falloff",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileAreaDamageFalloffTest::RunTest(const FString& parameters)
+{
+	// The scale is the set-by-caller magnitude QueueHit hands to the effect, so an edge target has to come out below a centre one
+	FProjectileAreaDamageFragment areaDamage;
+	areaDamage.Radius = 500.f;
+	for (const float innerRadiusFraction : { 0.f, 0.5f })
+	{
+		for (const float falloffExponent : { 0.5f, 1.f, 2.f })
+		{
+			areaDamage.InnerRadiusFraction = innerRadiusFraction;
+			areaDamage.FalloffExponent = falloffExponent;
+			const FString label = FString::Printf(TEXT("inner %.2f, exponent %.2f"), innerRadiusFraction, falloffExponent);
+
+			const float centreScale = areaDamage.GetDamageScale(0.f);
+			const float edgeScale = areaDamage.GetDamageScale(areaDamage.Radius * 0.99f);
+			TestEqual(FString::Printf(TEXT("Centre takes full damage (%s)"), *label), centreScale, 1.f);
+			TestTrue(FString::Printf(TEXT("Edge takes less than the centre (%s)"), *label), edgeScale < centreScale);
+			TestTrue(FString::Printf(TEXT("Falloff doesn't increase with distance (%s)"), *label),
+				areaDamage.GetDamageScale(areaDamage.Radius * 0.75f) >= edgeScale);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileAreaDamageGroupingTest, "Projectiles.AreaDamage.Grouping",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileAreaDamageGroupingTest::RunTest(const FString& parameters)
+{
+	using namespace ProjectileHitProcessor;
+
+	// Grouping only compares actor pointers, so class defaults stand in for spawned actors
+	AActor* target = GetMutableDefault<AActor>();
+	AActor* bystander = GetMutableDefault<APawn>();
+
+	FProjectileAreaDamageFragment areaDamage;
+	areaDamage.Radius = 500.f;
+	areaDamage.OverlapObjectType = ECC_Pawn;
+
+	const FVector closePoint(300.0, 0.0, 0.0);
+	const FAreaDamageOverlap closeComponent{ target, nullptr, FBox::BuildAABB(closePoint, FVector(10.0)), ECC_Pawn };
+	const FAreaDamageOverlap farComponent{ target, nullptr, FBox::BuildAABB(FVector(450.0, 0.0, 0.0), FVector(10.0)), ECC_Pawn };
+	// A repeated component, one out of range and one of a type the blast doesn't overlap
+	const FAreaDamageOverlap overlaps[] = {
+		closeComponent,
+		farComponent,
+		closeComponent,
+		{ bystander, nullptr, FBox::BuildAABB(FVector(2000.0, 0.0, 0.0), FVector(10.0)), ECC_Pawn },
+		{ bystander, nullptr, FBox::BuildAABB(FVector(50.0, 0.0, 0.0), FVector(10.0)), ECC_WorldStatic },
+	};
+
+	const FProjectileExplosion firstBlast{ FVector(0.0, 0.0, 0.0), nullptr, nullptr, &areaDamage };
+	const FProjectileExplosion secondBlast{ FVector(100.0, 0.0, 0.0), nullptr, nullptr, &areaDamage };
+
+	TMap<FTargetKey, FTargetDamage> targets;
+	FBlastTargets blastTargets;
+	AccumulateBlast(firstBlast, overlaps, blastTargets, targets);
+	AccumulateBlast(secondBlast, overlaps, blastTargets, targets);
+
+	if (!TestEqual(TEXT("Only the actor in range of both blasts is a target"), targets.Num(), 1))
+	{
+		return false;
+	}
+
+	const FTargetDamage* targetDamage = targets.Find({ target, &areaDamage, nullptr });
+	if (!TestNotNull(TEXT("Target is keyed by actor, area damage and instigator"), targetDamage))
+	{
+		return false;
+	}
+
+	// Each blast counts once, from the closest component, however often the overlap reported it
+	const float expectedScale = areaDamage.GetDamageScale(290.f) + areaDamage.GetDamageScale(190.f);
+	TestEqual(TEXT("Overlapping blasts sum"), targetDamage->DamageScale, expectedScale, UE_KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Hit comes from the first blast's closest component"), targetDamage->ImpactPoint, FVector(290.0, 0.0, 0.0));
+	TestEqual(TEXT("Hit origin is the first blast"), targetDamage->Origin, firstBlast.Location);
+
+	// A blast from another instigator is damage in its own right
+	AActor* otherInstigator = GetMutableDefault<APawn>();
+	const FProjectileExplosion otherBlast{ FVector(0.0, 0.0, 0.0), otherInstigator, nullptr, &areaDamage };
+	AccumulateBlast(otherBlast, overlaps, blastTargets, targets);
+	TestEqual(TEXT("Another instigator's blast is a separate target"), targets.Num(), 2);
+	TestEqual(TEXT("Another instigator's blast doesn't add to the first"), targets.FindChecked({ target, &areaDamage, nullptr }).DamageScale, expectedScale, UE_KINDA_SMALL_NUMBER);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -4,10 +4,23 @@
 
 #include "CoreMinimal.h"
 #include "MassSignalProcessorBase.h"
+#include "Mass/ProjectileHitSubsystem.h"
 #include "ProjectileHitProcessor.generated.h"
 
+struct FProjectileAreaDamageFragment;
+
+// An impact with area damage, gathered over the frame and resolved together
+struct FProjectileExplosion
+{
+	FVector Location;
+	TWeakObjectPtr<AActor> Instigator;
+	TWeakObjectPtr<AActor> Owner;
+	const FProjectileAreaDamageFragment* AreaDamage = nullptr;
+};
+
 /**
- * 
+ * Worker thread half of hit processing, resolves targets and queues entity destruction
+ * Effects are applied afterwards by UProjectileHitApplyProcessor on the game thread
  */
 UCLASS()
 class LYRAGAME_API UProjectileHitProcessor : public UMassSignalProcessorBase//UMassProcessor
@@ -21,4 +34,15 @@ protected:
 	virtual void Initialize(UObject& owner) override;
 	virtual void ConfigureQueries() override;
 	virtual void SignalEntities(FMassEntityManager& entityManager, FMassExecutionContext& context, FMassSignalNameLookup& entitysignals) override;
+
+	// Queues area damage for every explosion in FrameExplosions, deduplicating targets caught by several blasts
+	void ResolveAreaDamage(UWorld& world);
+
+	// Cosmetic projectiles on standalone and listen servers
+	FMassEntityQuery CosmeticQuery;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileHitSubsystem> HitSubsystem;
+
+	TArray<FProjectileExplosion> FrameExplosions;
 };
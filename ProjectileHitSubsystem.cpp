@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileHitSubsystem.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+
+bool UProjectileHitSubsystem::QueueHit(const FHitResult& hit, AActor* instigator, AActor* owner, const UGameplayEffect* damageEffect, const FGameplayTag& setByCallerTag, float magnitude)
+{
+	AActor* hitActor = hit.GetActor();
+	if (hitActor == nullptr)
+	{
+		return false;
+	}
+
+	// Only copies pointers and plain data, finding the ability system component and allocating the effect context call
+	// into the actor's components so wait for the game thread apply stage
+	FScopeLock lock(&PendingLock);
+	PendingDebugImpacts.Add(hit.ImpactPoint);
+	if (damageEffect == nullptr)
+	{
+		return false;
+	}
+
+	FProjectileHitApplyRecord& record = PendingRecords.AddDefaulted_GetRef();
+	record.Hit = hit;
+	record.Target = hitActor;
+	record.Instigator = instigator;
+	record.Owner = owner;
+	record.DamageEffect = damageEffect;
+	record.SetByCallerTag = setByCallerTag;
+	record.Magnitude = magnitude;
+	return true;
+}
+
+void UProjectileHitSubsystem::ConsumePendingHits(TArray<FProjectileHitApplyRecord>& outRecords, TArray<FVector>& outDebugImpacts)
+{
+	check(IsInGameThread());
+
+	FScopeLock lock(&PendingLock);
+	outRecords.Reset();
+	outDebugImpacts.Reset();
+	Swap(outRecords, PendingRecords);
+	Swap(outDebugImpacts, PendingDebugImpacts);
+}
+
+void UProjectileHitSubsystem::QueueClientHit(const FProjectileConfirmedHit& hit)
+{
+	FScopeLock lock(&ClientHitsLock);
+	PendingClientHits.Add(hit);
+}
+
+void UProjectileHitSubsystem::ConsumeClientHits(TArray<FProjectileConfirmedHit>& outHits)
+{
+	check(IsInGameThread());
+
+	FScopeLock lock(&ClientHitsLock);
+	outHits.Append(PendingClientHits);
+	PendingClientHits.Reset();
+}
+
+const AController* UProjectileHitSubsystem::GetInstigatorController(const AActor* instigator)
+{
+	if (const AController* controller = Cast<AController>(instigator))
+	{
+		return controller;
+	}
+	if (const APawn* pawn = Cast<APawn>(instigator))
+	{
+		return pawn->GetController();
+	}
+	return nullptr;
+}
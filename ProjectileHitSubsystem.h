@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/HitResult.h"
+#include "GameplayTagContainer.h"
+#include "Mass/ProjectileHitConfirmation.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileHitSubsystem.generated.h"
+
+class AController;
+class UAbilitySystemComponent;
+class UGameplayEffect;
+
+// Everything the game thread needs to apply a resolved hit, built off the game thread
+// Only holds plain data, the target's ability system component is looked up by the apply stage
+struct FProjectileHitApplyRecord
+{
+	FHitResult Hit;
+	TWeakObjectPtr<AActor> Target;
+	TWeakObjectPtr<AActor> Instigator;
+	TWeakObjectPtr<AActor> Owner;
+	TWeakObjectPtr<const UGameplayEffect> DamageEffect;
+
+	// Filled in on the game thread by UProjectileHitApplyProcessor
+	TWeakObjectPtr<UAbilitySystemComponent> TargetASC;
+
+	// Only used when SetByCallerTag is valid
+	FGameplayTag SetByCallerTag;
+	float Magnitude = 1.f;
+};
+
+/**
+ * Hand-off point between the hit resolve stage (any thread) and the hit apply stage (game thread)
+ */
+UCLASS()
+class LYRAGAME_API UProjectileHitSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Queues an apply record for the hit actor, safe to call from any thread
+	bool QueueHit(const FHitResult& hit, AActor* instigator, AActor* owner, const UGameplayEffect* damageEffect, const FGameplayTag& setByCallerTag = FGameplayTag(), float magnitude = 1.f);
+
+	// Swaps out everything queued so far, game thread only
+	void ConsumePendingHits(TArray<FProjectileHitApplyRecord>& outRecords, TArray<FVector>& outDebugImpacts);
+
+	// Client side, hits to be reported to the server by UProjectileHitConfirmationComponent. Safe to call from any thread
+	void QueueClientHit(const FProjectileConfirmedHit& hit);
+	// Appends everything queued so far, game thread only
+	void ConsumeClientHits(TArray<FProjectileConfirmedHit>& outHits);
+
+	// Projectile instigators are either a pawn or a controller
+	static const AController* GetInstigatorController(const AActor* instigator);
+
+protected:
+	FCriticalSection PendingLock;
+	TArray<FProjectileHitApplyRecord> PendingRecords;
+	TArray<FVector> PendingDebugImpacts;
+
+	FCriticalSection ClientHitsLock;
+	TArray<FProjectileConfirmedHit> PendingClientHits;
+};
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileHitscanSubsystem.h"
+#include "GameplayEffect.h"
+#include "Mass/ProjectileHitSubsystem.h"
+#include "Mass/ProjectileStats.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Scheduled Hitscan Hits"), STAT_ProjectileHitscan_Scheduled, STATGROUP_LightweightProjectiles);
+
+void UProjectileHitscanSubsystem::Tick(float deltaTime)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileHitscanSubsystem_Tick);
+
+	const UWorld* world = GetWorld();
+	UProjectileHitSubsystem* hitSS = world->GetSubsystem<UProjectileHitSubsystem>();
+	const double now = world->GetTimeSeconds();
+
+	while (ScheduledHits.Num() > 0 && ScheduledHits.HeapTop().ArrivalTime <= now)
+	{
+		FScheduledHit scheduledHit;
+		ScheduledHits.HeapPop(scheduledHit, false);
+
+		// Instigator may be gone by now, the hit still lands, same as a simulated projectile's would
+		if (hitSS && scheduledHit.Hit.GetActor() != nullptr)
+		{
+			hitSS->QueueHit(scheduledHit.Hit, scheduledHit.Instigator.Get(), scheduledHit.Owner.Get(), scheduledHit.DamageEffect.Get());
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ProjectileHitscan_Scheduled, ScheduledHits.Num());
+}
+
+TStatId UProjectileHitscanSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileHitscanSubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileHitscanSubsystem::ScheduleHit(double arrivalTime, const FHitResult& hit, AActor* instigator, AActor* owner, const UGameplayEffect* damageEffect)
+{
+	check(IsInGameThread());
+	ScheduledHits.HeapPush({ arrivalTime, hit, instigator, owner, damageEffect });
+}
+
+bool UProjectileHitscanSubsystem::DoesSupportWorldType(EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/HitResult.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileHitscanSubsystem.generated.h"
+
+class UGameplayEffect;
+
+/**
+ * Holds hits resolved at spawn for projectiles too fast to be worth simulating, see FProjectileHitscanFragment,
+ * and hands each one to UProjectileHitSubsystem once the projectile would have reached its target
+ */
+UCLASS()
+class LYRAGAME_API UProjectileHitscanSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float deltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Game thread only, arrivalTime is in world time seconds
+	void ScheduleHit(double arrivalTime, const FHitResult& hit, AActor* instigator, AActor* owner, const UGameplayEffect* damageEffect);
+
+	int32 GetNumScheduledHits() const { return ScheduledHits.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type worldType) const override;
+
+	struct FScheduledHit
+	{
+		double ArrivalTime;
+		FHitResult Hit;
+		TWeakObjectPtr<AActor> Instigator;
+		TWeakObjectPtr<AActor> Owner;
+		TWeakObjectPtr<const UGameplayEffect> DamageEffect;
+
+		bool operator<(const FScheduledHit& other) const { return ArrivalTime < other.ArrivalTime; }
+	};
+
+	// Heap, earliest arrival first
+	TArray<FScheduledHit> ScheduledHits;
+};
@@ -0,0 +1,516 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HAL/IConsoleManager.h"
+#include "MassMovementFragments.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileMovementKernel.h"
+#include "Mass/ProjectileStats.h"
+
+/**
+ * Golden trajectory checks for the movement kernels. Each scenario is a fixed spawn set flown through a fixed
+ * analytic collision layout at a fixed delta time. The scalar reference kernel produces the golden trajectories, recorded
+ * from an editor build with Projectiles.ValidateKernels Record and checked in next to this file, and the current reference
+ * and every other mode have to reproduce them within tolerance. Only every SampleInterval-th frame and the hits are stored,
+ * drift accumulates so a sparse check still catches it.
+ * Runs without a map or physics scene as the Projectiles.Movement.KernelGolden automation test, or Projectiles.ValidateKernels.
+ * Collision here is the analytic layout below, so this covers integration, ordering and retirement but not the physics
+ * sweeps UProjectileMovementProcessor issues, those need a map.
+ */
+namespace ProjectileKernelValidation
+{
+	constexpr uint32 GoldenFileMagic = 'PKGT';
+	constexpr uint32 GoldenFileVersion = 2;
+	constexpr int32 NumEntities = 64;
+	constexpr int32 NumFrames = 240;
+	constexpr int32 SampleInterval = 24;
+	constexpr int32 NumSampledFrames = NumFrames / SampleInterval;
+	constexpr double DefaultTolerance = 0.01;
+
+	struct FScenario
+	{
+		const TCHAR* Name;
+		uint32 Seed;
+		float DeltaTime;
+		float SweepRadius;
+		bool bUseForces;
+		bool bUseDrag;
+		FProjectileDragFragment Drag;
+	};
+
+	// Static collision: ground plane at z=0, a wall facing -X and a sphere sitting on the ground in front of it
+	const FVector WallPoint(6000.0, 0.0, 0.0);
+	const FVector WallNormal(-1.0, 0.0, 0.0);
+	const FVector SphereCentre(3000.0, 0.0, 400.0);
+	constexpr double SphereRadius = 400.0;
+
+	struct FSample
+	{
+		FVector Position = FVector::ZeroVector;
+		FVector Velocity = FVector::ZeroVector;
+
+		friend FArchive& operator<<(FArchive& ar, FSample& sample)
+		{
+			return ar << sample.Position << sample.Velocity;
+		}
+	};
+
+	struct FHitRecord
+	{
+		int32 Frame = INDEX_NONE;
+		FVector Location = FVector::ZeroVector;
+		FVector Normal = FVector::ZeroVector;
+
+		friend FArchive& operator<<(FArchive& ar, FHitRecord& hit)
+		{
+			return ar << hit.Frame << hit.Location << hit.Normal;
+		}
+	};
+
+	// Indexed by spawn index, samples are [sampled frame * NumEntities + spawn index] and stop changing after a hit
+	struct FTrajectories
+	{
+		TArray<FSample> Samples;
+		TArray<FHitRecord> Hits;
+
+		friend FArchive& operator<<(FArchive& ar, FTrajectories& trajectories)
+		{
+			return ar << trajectories.Samples << trajectories.Hits;
+		}
+	};
+
+	// Live entities, packed and swap-removed on death the way a chunk would be
+	struct FSimState
+	{
+		TArray<int32> SpawnIndices;
+		TArray<FVector> Positions;
+		TArray<FMassVelocityFragment> Velocities;
+		TArray<FMassForceFragment> Forces;
+		TArray<int32> SweepOrder;
+		// Latest state by spawn index, dead entities keep where they stopped
+		TArray<FSample> LastSamples;
+	};
+
+	using FStepFunction = void(*)(FSimState& state, const FScenario& scenario, int32 frame, FTrajectories& out);
+
+	// Fixed LCG rather than FRandomStream so the golden data doesn't depend on the engine's generator
+	struct FGoldenRandom
+	{
+		uint32 State;
+
+		double Range(double min, double max)
+		{
+			State = State * 1664525u + 1013904223u;
+			return min + (max - min) * ((State >> 8) / 16777216.0);
+		}
+	};
+
+	static TArray<FScenario> MakeScenarios()
+	{
+		TArray<FScenario> scenarios;
+
+		scenarios.Add({ TEXT("Ballistic"), 0x1001, 1.f / 60.f, 0.f, false, false, FProjectileDragFragment() });
+
+		FProjectileDragFragment constantDrag;
+		constantDrag.DragCoefficient = 2e-5f;
+		scenarios.Add({ TEXT("ConstantDrag"), 0x1002, 1.f / 30.f, 5.f, false, true, constantDrag });
+
+		// Fixed synthetic transonic bump rather than the trait's G1/G7 tables, so golden files don't move when those are retuned
+		FProjectileDragFragment machDrag;
+		machDrag.DragCoefficient = 1e-5f;
+		machDrag.MaxSpeed = 60000.f;
+		for (int32 idx = 0; idx * machDrag.MachTableStep <= 5.f; ++idx)
+		{
+			const float mach = idx * machDrag.MachTableStep;
+			machDrag.MachDragTable.Add(1.f + 1.5f * FMath::Exp(-FMath::Square((mach - 1.1f) * 3.f)));
+		}
+		scenarios.Add({ TEXT("MachTableThrust"), 0x1003, 1.f / 120.f, 2.f, true, true, machDrag });
+
+		return scenarios;
+	}
+
+	static void Spawn(const FScenario& scenario, FSimState& state)
+	{
+		FGoldenRandom random{ scenario.Seed };
+		for (int32 idx = 0; idx < NumEntities; ++idx)
+		{
+			// One draw per statement, argument evaluation order differs between compilers and the golden data has to match all of them
+			const double startX = random.Range(-2000.0, 2000.0);
+			const double startY = random.Range(-1000.0, 1000.0);
+			const double startZ = random.Range(50.0, 1500.0);
+			const double directionY = random.Range(-0.3, 0.3);
+			const double directionZ = random.Range(-0.2, 0.6);
+			const double speed = random.Range(1000.0, 40000.0);
+			const FVector start(startX, startY, startZ);
+			const FVector direction = FVector(1.0, directionY, directionZ).GetSafeNormal();
+
+			state.SpawnIndices.Add(idx);
+			state.LastSamples.AddDefaulted();
+			state.Positions.Add(start);
+			state.Velocities.AddDefaulted_GetRef().Value = direction * speed;
+			state.Forces.AddDefaulted_GetRef().Value = scenario.bUseForces ? direction * random.Range(0.0, 5000.0) : FVector::ZeroVector;
+		}
+	}
+
+	// Earliest time of impact along start->end against the analytic layout, inflated by the sweep radius
+	static bool Sweep(const FVector& start, const FVector& end, double radius, FVector& outLocation, FVector& outNormal)
+	{
+		const FVector delta = end - start;
+		double bestAlpha = 2.0;
+
+		auto testPlane = [&](const FVector& point, const FVector& normal)
+		{
+			const double startDist = FVector::DotProduct(start - point, normal) - radius;
+			const double endDist = FVector::DotProduct(end - point, normal) - radius;
+			if (startDist >= 0.0 && endDist < 0.0)
+			{
+				const double alpha = startDist / (startDist - endDist);
+				if (alpha < bestAlpha)
+				{
+					bestAlpha = alpha;
+					outNormal = normal;
+				}
+			}
+		};
+
+		testPlane(FVector::ZeroVector, FVector::UpVector);
+		testPlane(WallPoint, WallNormal);
+
+		const double inflatedRadius = SphereRadius + radius;
+		const FVector toStart = start - SphereCentre;
+		const double a = delta.SizeSquared();
+		const double b = 2.0 * FVector::DotProduct(toStart, delta);
+		const double c = toStart.SizeSquared() - inflatedRadius * inflatedRadius;
+		const double discriminant = b * b - 4.0 * a * c;
+		if (a > UE_DOUBLE_SMALL_NUMBER && c >= 0.0 && discriminant >= 0.0)
+		{
+			const double alpha = (-b - FMath::Sqrt(discriminant)) / (2.0 * a);
+			if (alpha >= 0.0 && alpha <= 1.0 && alpha < bestAlpha)
+			{
+				bestAlpha = alpha;
+				outNormal = (start + delta * alpha - SphereCentre).GetSafeNormal();
+			}
+		}
+
+		if (bestAlpha > 1.0)
+		{
+			return false;
+		}
+		outLocation = start + delta * bestAlpha;
+		return true;
+	}
+
+	// Same per-entity step as UProjectileMovementProcessor: move along the integrated velocity, stop at the first hit
+	static void SweepEntity(FSimState& state, int32 slot, const FScenario& scenario, int32 frame, TArray<int32>& deadSlots, FTrajectories& out)
+	{
+		const FVector startPos = state.Positions[slot];
+		const FVector endPos = startPos + state.Velocities[slot].Value * scenario.DeltaTime;
+
+		FVector hitLocation;
+		FVector hitNormal;
+		if (Sweep(startPos, endPos, scenario.SweepRadius, hitLocation, hitNormal))
+		{
+			state.Positions[slot] = hitLocation;
+			out.Hits[state.SpawnIndices[slot]] = { frame, hitLocation, hitNormal };
+			deadSlots.Add(slot);
+		}
+		else
+		{
+			state.Positions[slot] = endPos;
+		}
+	}
+
+	static void RecordAndRetire(FSimState& state, int32 frame, TArray<int32>& deadSlots, FTrajectories& out)
+	{
+		for (int32 slot = 0; slot < state.SpawnIndices.Num(); ++slot)
+		{
+			state.LastSamples[state.SpawnIndices[slot]] = { state.Positions[slot], state.Velocities[slot].Value };
+		}
+
+		if ((frame + 1) % SampleInterval == 0)
+		{
+			FMemory::Memcpy(&out.Samples[(frame / SampleInterval) * NumEntities], state.LastSamples.GetData(), NumEntities * sizeof(FSample));
+		}
+
+		deadSlots.Sort(TGreater<int32>());
+		for (const int32 slot : deadSlots)
+		{
+			state.SpawnIndices.RemoveAtSwap(slot, 1, false);
+			state.Positions.RemoveAtSwap(slot, 1, false);
+			state.Velocities.RemoveAtSwap(slot, 1, false);
+			state.Forces.RemoveAtSwap(slot, 1, false);
+		}
+		deadSlots.Reset();
+	}
+
+	static void StepReference(FSimState& state, const FScenario& scenario, int32 frame, FTrajectories& out)
+	{
+		const FVector gravity(0.0, 0.0, -980.0);
+		const FProjectileDragFragment* drag = scenario.bUseDrag ? &scenario.Drag : nullptr;
+
+		TArray<int32> deadSlots;
+		for (int32 slot = 0; slot < state.SpawnIndices.Num(); ++slot)
+		{
+			UE::Projectiles::Kernel::IntegrateVelocityReference(state.Velocities[slot].Value, state.Forces[slot].Value, gravity, drag, scenario.DeltaTime);
+			SweepEntity(state, slot, scenario, frame, deadSlots, out);
+		}
+		RecordAndRetire(state, frame, deadSlots, out);
+	}
+
+	static void StepBatched(FSimState& state, const FScenario& scenario, int32 frame, FTrajectories& out)
+	{
+		const FVector gravity(0.0, 0.0, -980.0);
+		UE::Projectiles::Kernel::IntegrateVelocities(state.Velocities, state.Forces, gravity, scenario.bUseDrag ? &scenario.Drag : nullptr, scenario.DeltaTime);
+
+		TArray<int32> deadSlots;
+		for (int32 slot = 0; slot < state.SpawnIndices.Num(); ++slot)
+		{
+			SweepEntity(state, slot, scenario, frame, deadSlots, out);
+		}
+		RecordAndRetire(state, frame, deadSlots, out);
+	}
+
+	static void StepBatchedMortonOrder(FSimState& state, const FScenario& scenario, int32 frame, FTrajectories& out)
+	{
+		const FVector gravity(0.0, 0.0, -980.0);
+		UE::Projectiles::Kernel::IntegrateVelocities(state.Velocities, state.Forces, gravity, scenario.bUseDrag ? &scenario.Drag : nullptr, scenario.DeltaTime);
+
+		// Re-sorted on entity count changes and every few frames like the processor, so a reused order gets exercised too
+		if (state.SweepOrder.Num() != state.SpawnIndices.Num() || frame % 8 == 0)
+		{
+			UE::Projectiles::Kernel::SortByMortonKey(state.Positions, 500.f, state.SweepOrder);
+		}
+
+		TArray<int32> deadSlots;
+		for (const int32 slot : state.SweepOrder)
+		{
+			SweepEntity(state, slot, scenario, frame, deadSlots, out);
+		}
+		RecordAndRetire(state, frame, deadSlots, out);
+	}
+
+	// Round trips the state through a compact fragment every frame, so velocities (and positions for the
+	// relative layout) carry exactly the precision the compact layouts store
+	template<typename TState>
+	static void StepCompact(FSimState& state, const FScenario& scenario, int32 frame, FTrajectories& out)
+	{
+		const int32 numEntities = state.SpawnIndices.Num();
+		TArray<TState> states;
+		states.SetNum(numEntities);
+		for (int32 slot = 0; slot < numEntities; ++slot)
+		{
+			states[slot].SetPosition(state.Positions[slot]);
+			states[slot].SetVelocity(state.Velocities[slot].Value);
+		}
+
+		const FVector gravity(0.0, 0.0, -980.0);
+		UE::Projectiles::Kernel::IntegrateStates(states, gravity, scenario.bUseDrag ? &scenario.Drag : nullptr, scenario.DeltaTime);
+
+		TArray<int32> deadSlots;
+		for (int32 slot = 0; slot < numEntities; ++slot)
+		{
+			state.Positions[slot] = states[slot].GetPosition();
+			state.Velocities[slot].Value = states[slot].GetVelocity();
+			SweepEntity(state, slot, scenario, frame, deadSlots, out);
+
+			states[slot].SetPosition(state.Positions[slot]);
+			state.Positions[slot] = states[slot].GetPosition();
+		}
+		RecordAndRetire(state, frame, deadSlots, out);
+	}
+
+	static FTrajectories Simulate(const FScenario& scenario, FStepFunction step)
+	{
+		FSimState state;
+		Spawn(scenario, state);
+
+		FTrajectories out;
+		out.Samples.SetNum(NumEntities * NumSampledFrames);
+		out.Hits.SetNum(NumEntities);
+		for (int32 frame = 0; frame < NumFrames; ++frame)
+		{
+			step(state, scenario, frame, out);
+		}
+		return out;
+	}
+
+	// Returns the number of mismatches, logging the worst offenders
+	static int32 Compare(const TCHAR* label, const FTrajectories& golden, const FTrajectories& test, double tolerance)
+	{
+		if (golden.Samples.Num() != test.Samples.Num() || golden.Hits.Num() != test.Hits.Num())
+		{
+			UE_LOG(LogLightweightProjectiles, Error, TEXT("  %s: trajectory layout doesn't match golden data"), label);
+			return 1;
+		}
+
+		int32 numMismatches = 0;
+		double maxPositionError = 0.0;
+		double maxVelocityError = 0.0;
+		for (int32 sampleIdx = 0; sampleIdx < golden.Samples.Num(); ++sampleIdx)
+		{
+			const double positionError = FVector::Dist(golden.Samples[sampleIdx].Position, test.Samples[sampleIdx].Position);
+			const double velocityError = FVector::Dist(golden.Samples[sampleIdx].Velocity, test.Samples[sampleIdx].Velocity);
+			maxPositionError = FMath::Max(maxPositionError, positionError);
+			maxVelocityError = FMath::Max(maxVelocityError, velocityError);
+			if (positionError > tolerance || velocityError > tolerance)
+			{
+				if (numMismatches++ == 0)
+				{
+					UE_LOG(LogLightweightProjectiles, Error, TEXT("  %s: entity %d drifted by frame %d (position %.4f, velocity %.4f)"),
+						label, sampleIdx % NumEntities, (sampleIdx / NumEntities + 1) * SampleInterval - 1, positionError, velocityError);
+				}
+			}
+		}
+
+		for (int32 spawnIdx = 0; spawnIdx < golden.Hits.Num(); ++spawnIdx)
+		{
+			const FHitRecord& goldenHit = golden.Hits[spawnIdx];
+			const FHitRecord& testHit = test.Hits[spawnIdx];
+			if (goldenHit.Frame != testHit.Frame || FVector::Dist(goldenHit.Location, testHit.Location) > tolerance || !goldenHit.Normal.Equals(testHit.Normal, 1e-3))
+			{
+				++numMismatches;
+				UE_LOG(LogLightweightProjectiles, Error, TEXT("  %s: entity %d hit at frame %d %s, expected frame %d %s"),
+					label, spawnIdx, testHit.Frame, *testHit.Location.ToString(), goldenHit.Frame, *goldenHit.Location.ToString());
+			}
+		}
+
+		UE_LOG(LogLightweightProjectiles, Display, TEXT("  %-24s %s (max position error %.6f, max velocity error %.6f)"),
+			label, numMismatches == 0 ? TEXT("ok") : TEXT("FAILED"), maxPositionError, maxVelocityError);
+		return numMismatches;
+	}
+
+	// Lives with the source rather than Saved/ so it's versioned alongside the kernels it checks, so editor builds only
+	static FString GetGoldenFilePath()
+	{
+		return FPaths::GameSourceDir() / TEXT("LyraGame") / TEXT("Mass") / TEXT("ProjectileKernelGolden.bin");
+	}
+
+	static void Record()
+	{
+		const TArray<FScenario> scenarios = MakeScenarios();
+		TArray<FTrajectories> references;
+		for (const FScenario& scenario : scenarios)
+		{
+			references.Add(Simulate(scenario, &StepReference));
+		}
+
+		const FString goldenPath = GetGoldenFilePath();
+		TArray<uint8> bytes;
+		FMemoryWriter writer(bytes);
+		uint32 magic = GoldenFileMagic;
+		uint32 version = GoldenFileVersion;
+		writer << magic << version << references;
+		if (FFileHelper::SaveArrayToFile(bytes, *goldenPath))
+		{
+			UE_LOG(LogLightweightProjectiles, Display, TEXT("Recorded golden trajectories for %d scenarios to %s"), scenarios.Num(), *goldenPath);
+		}
+		else
+		{
+			UE_LOG(LogLightweightProjectiles, Error, TEXT("Couldn't write golden trajectories to %s"), *goldenPath);
+		}
+	}
+
+	// Returns the number of failed mode/scenario pairs, a missing or stale golden file counts as a failure
+	static int32 Validate(double tolerance)
+	{
+		struct FMode
+		{
+			const TCHAR* Name;
+			FStepFunction Step;
+			// Float state drifts further from the double reference, so gets a looser bound
+			double ToleranceScale;
+			bool bSupportsForces;
+		};
+		const FMode modes[] = {
+			{ TEXT("Reference"), &StepReference, 1.0, true },
+			{ TEXT("Batched"), &StepBatched, 1.0, true },
+			{ TEXT("BatchedMortonOrder"), &StepBatchedMortonOrder, 1.0, true },
+			{ TEXT("Compact"), &StepCompact<FProjectileStateFragment>, 100.0, false },
+			{ TEXT("CompactFloat"), &StepCompact<FProjectileRelativeStateFragment>, 100.0, false },
+		};
+
+		const TArray<FScenario> scenarios = MakeScenarios();
+		const FString goldenPath = GetGoldenFilePath();
+
+		TArray<FTrajectories> goldens;
+		TArray<uint8> bytes;
+		if (FFileHelper::LoadFileToArray(bytes, *goldenPath, FILEREAD_Silent))
+		{
+			FMemoryReader reader(bytes);
+			uint32 magic = 0;
+			uint32 version = 0;
+			reader << magic << version;
+			if (magic == GoldenFileMagic && version == GoldenFileVersion)
+			{
+				reader << goldens;
+			}
+		}
+		if (goldens.Num() != scenarios.Num())
+		{
+			UE_LOG(LogLightweightProjectiles, Error, TEXT("No usable golden trajectories at %s. Run Projectiles.ValidateKernels Record from a known good editor build and check the file in"), *goldenPath);
+			return 1;
+		}
+
+		int32 numFailures = 0;
+		for (int32 scenarioIdx = 0; scenarioIdx < scenarios.Num(); ++scenarioIdx)
+		{
+			const FScenario& scenario = scenarios[scenarioIdx];
+			UE_LOG(LogLightweightProjectiles, Display, TEXT("%s: %d entities, %d frames at %.4fs"), scenario.Name, NumEntities, NumFrames, scenario.DeltaTime);
+
+			for (const FMode& mode : modes)
+			{
+				if (scenario.bUseForces && !mode.bSupportsForces)
+				{
+					continue;
+				}
+				numFailures += Compare(mode.Name, goldens[scenarioIdx], Simulate(scenario, mode.Step), tolerance * mode.ToleranceScale) > 0 ? 1 : 0;
+			}
+		}
+
+		if (numFailures > 0)
+		{
+			UE_LOG(LogLightweightProjectiles, Error, TEXT("Kernel validation FAILED: %d mode/scenario pairs outside %.4f tolerance"), numFailures, tolerance);
+		}
+		else
+		{
+			UE_LOG(LogLightweightProjectiles, Display, TEXT("Kernel validation passed"));
+		}
+		return numFailures;
+	}
+
+	static void Run(const TArray<FString>& args)
+	{
+		if (args.Num() > 0 && args[0] == TEXT("Record"))
+		{
+			Record();
+			return;
+		}
+
+		Validate(args.Num() > 0 ? FCString::Atod(*args[0]) : DefaultTolerance);
+	}
+}
+
+static FAutoConsoleCommand ProjectileKernelValidationCmd(
+	TEXT("Projectiles.ValidateKernels"),
+	TEXT("Checks every movement kernel mode against golden trajectories. Args: [Tolerance=0.01], or Record to rewrite the golden file"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ProjectileKernelValidation::Run));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// The golden file is read from the source tree, which cooked builds don't have
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileKernelGoldenTest, "Projectiles.Movement.KernelGolden",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileKernelGoldenTest::RunTest(const FString& parameters)
+{
+	const int32 numFailures = ProjectileKernelValidation::Validate(ProjectileKernelValidation::DefaultTolerance);
+	TestEqual(TEXT("Kernel mode/scenario pairs outside tolerance"), numFailures, 0);
+	return numFailures == 0;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
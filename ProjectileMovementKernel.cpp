@@ -0,0 +1,212 @@
+#include "Mass/ProjectileMovementKernel.h"
+#include "MassMovementFragments.h"
+#include "Mass/ProjectileFragments.h"
+
+namespace UE::Projectiles::Kernel
+{
+	namespace Private
+	{
+		// Spreads the low 21 bits out so there are two zero bits between each
+		static uint64 SpreadBits3(uint64 value)
+		{
+			value &= 0x1fffff;
+			value = (value | value << 32) & 0x1f00000000ffff;
+			value = (value | value << 16) & 0x1f0000ff0000ff;
+			value = (value | value << 8) & 0x100f00f00f00f00f;
+			value = (value | value << 4) & 0x10c30c30c30c30c3;
+			value = (value | value << 2) & 0x1249249249249249;
+			return value;
+		}
+
+		template<typename TState>
+		static void IntegrateStates(TArrayView<TState> states, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime)
+		{
+			const FVector3f gravityDt(gravity * deltaTime);
+			if (drag == nullptr)
+			{
+				for (TState& state : states)
+				{
+					state.Velocity += gravityDt;
+				}
+				return;
+			}
+
+			const double dragDt = (double)drag->DragCoefficient * deltaTime;
+			const double maxSpeed = drag->MaxSpeed;
+			const bool bSampleTable = drag->MachDragTable.Num() > 0;
+
+			for (TState& state : states)
+			{
+				state.Velocity += gravityDt;
+
+				const double speed = state.Velocity.Size();
+				if (speed <= UE_DOUBLE_SMALL_NUMBER)
+				{
+					continue;
+				}
+
+				// Same implicit drag step as IntegrateVelocities
+				const double dragScale = bSampleTable ? drag->SampleDragScale((float)speed) : 1.0;
+				double speedScale = 1.0 / (1.0 + dragDt * dragScale * speed);
+				if (maxSpeed > 0.0 && speed * speedScale > maxSpeed)
+				{
+					speedScale = maxSpeed / speed;
+				}
+
+				state.Velocity *= (float)speedScale;
+			}
+		}
+
+		static float WrapOctahedron(float value, float other)
+		{
+			return (1.f - FMath::Abs(other)) * (value >= 0.f ? 1.f : -1.f);
+		}
+	}
+
+	void IntegrateVelocities(TArrayView<FMassVelocityFragment> velocities, TConstArrayView<FMassForceFragment> forces, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime)
+	{
+		check(velocities.Num() == forces.Num());
+
+		const int32 numEntities = velocities.Num();
+		const VectorRegister4Double deltaTimeReg = VectorSetFloat1((double)deltaTime);
+		const FVector gravityDt = gravity * deltaTime;
+		const VectorRegister4Double gravityDtReg = VectorLoadFloat3_W0(&gravityDt.X);
+
+		if (drag == nullptr)
+		{
+			for (int32 idx = 0; idx < numEntities; ++idx)
+			{
+				double* velocity = &velocities[idx].Value.X;
+				const VectorRegister4Double velocityReg = VectorAdd(VectorLoadFloat3_W0(velocity), gravityDtReg);
+				VectorStoreFloat3(VectorMultiplyAdd(VectorLoadFloat3_W0(&forces[idx].Value.X), deltaTimeReg, velocityReg), velocity);
+			}
+			return;
+		}
+
+		const double dragDt = (double)drag->DragCoefficient * deltaTime;
+		const double maxSpeed = drag->MaxSpeed;
+		const bool bSampleTable = drag->MachDragTable.Num() > 0;
+
+		for (int32 idx = 0; idx < numEntities; ++idx)
+		{
+			double* velocity = &velocities[idx].Value.X;
+			VectorRegister4Double velocityReg = VectorAdd(VectorLoadFloat3_W0(velocity), gravityDtReg);
+			velocityReg = VectorMultiplyAdd(VectorLoadFloat3_W0(&forces[idx].Value.X), deltaTimeReg, velocityReg);
+
+			const double speed = FMath::Sqrt(VectorGetComponent(VectorDot3(velocityReg, velocityReg), 0));
+			if (speed <= UE_DOUBLE_SMALL_NUMBER)
+			{
+				VectorStoreFloat3(velocityReg, velocity);
+				continue;
+			}
+
+			// Implicit drag step, dv = -k * Cd(M) * |v| * v, stays stable however big the coefficient or delta time get
+			const double dragScale = bSampleTable ? drag->SampleDragScale((float)speed) : 1.0;
+			double speedScale = 1.0 / (1.0 + dragDt * dragScale * speed);
+			if (maxSpeed > 0.0 && speed * speedScale > maxSpeed)
+			{
+				speedScale = maxSpeed / speed;
+			}
+
+			VectorStoreFloat3(VectorMultiply(velocityReg, VectorSetFloat1(speedScale)), velocity);
+		}
+	}
+
+	void IntegrateVelocityReference(FVector& velocity, const FVector& force, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime)
+	{
+		velocity += gravity * deltaTime;
+		velocity += force * deltaTime;
+
+		if (drag == nullptr)
+		{
+			return;
+		}
+
+		const double speed = velocity.Size();
+		if (speed <= UE_DOUBLE_SMALL_NUMBER)
+		{
+			return;
+		}
+
+		const double dragScale = drag->MachDragTable.Num() > 0 ? drag->SampleDragScale((float)speed) : 1.0;
+		double speedScale = 1.0 / (1.0 + (double)drag->DragCoefficient * deltaTime * dragScale * speed);
+		if (drag->MaxSpeed > 0.0 && speed * speedScale > drag->MaxSpeed)
+		{
+			speedScale = drag->MaxSpeed / speed;
+		}
+
+		velocity *= speedScale;
+	}
+
+	void IntegrateStates(TArrayView<FProjectileStateFragment> states, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime)
+	{
+		Private::IntegrateStates(states, gravity, drag, deltaTime);
+	}
+
+	void IntegrateStates(TArrayView<FProjectileRelativeStateFragment> states, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime)
+	{
+		Private::IntegrateStates(states, gravity, drag, deltaTime);
+	}
+
+	uint32 PackDirection(const FVector3f& direction)
+	{
+		const float sum = FMath::Abs(direction.X) + FMath::Abs(direction.Y) + FMath::Abs(direction.Z);
+		if (sum <= UE_SMALL_NUMBER)
+		{
+			return PackDirection(FVector3f::ForwardVector);
+		}
+
+		float u = direction.X / sum;
+		float v = direction.Y / sum;
+		if (direction.Z < 0.f)
+		{
+			const float wrappedU = Private::WrapOctahedron(u, v);
+			v = Private::WrapOctahedron(v, u);
+			u = wrappedU;
+		}
+
+		const uint32 packedU = (uint32)FMath::RoundToInt32((FMath::Clamp(u, -1.f, 1.f) * 0.5f + 0.5f) * 65535.f);
+		const uint32 packedV = (uint32)FMath::RoundToInt32((FMath::Clamp(v, -1.f, 1.f) * 0.5f + 0.5f) * 65535.f);
+		return packedU | (packedV << 16);
+	}
+
+	FVector3f UnpackDirection(uint32 packedDirection)
+	{
+		const float u = (packedDirection & 0xffff) / 65535.f * 2.f - 1.f;
+		const float v = (packedDirection >> 16) / 65535.f * 2.f - 1.f;
+
+		FVector3f direction(u, v, 1.f - FMath::Abs(u) - FMath::Abs(v));
+		if (direction.Z < 0.f)
+		{
+			const float wrappedX = Private::WrapOctahedron(direction.X, direction.Y);
+			direction.Y = Private::WrapOctahedron(direction.Y, direction.X);
+			direction.X = wrappedX;
+		}
+		return direction.GetSafeNormal();
+	}
+
+	uint64 MortonKey(const FVector& location, float cellSize)
+	{
+		// Offset so negative coordinates keep their ordering once truncated to unsigned
+		constexpr int64 cellOffset = 1 << 20;
+		const double invCellSize = 1.0 / cellSize;
+		const uint64 x = (uint64)FMath::Clamp<int64>(FMath::FloorToInt64(location.X * invCellSize) + cellOffset, 0, 0x1fffff);
+		const uint64 y = (uint64)FMath::Clamp<int64>(FMath::FloorToInt64(location.Y * invCellSize) + cellOffset, 0, 0x1fffff);
+		const uint64 z = (uint64)FMath::Clamp<int64>(FMath::FloorToInt64(location.Z * invCellSize) + cellOffset, 0, 0x1fffff);
+		return Private::SpreadBits3(x) | (Private::SpreadBits3(y) << 1) | (Private::SpreadBits3(z) << 2);
+	}
+
+	void SortByMortonKey(TConstArrayView<FVector> locations, float cellSize, TArray<int32>& outOrder)
+	{
+		TArray<uint64, TInlineAllocator<256>> keys;
+		keys.SetNumUninitialized(locations.Num());
+		outOrder.SetNumUninitialized(locations.Num());
+		for (int32 idx = 0; idx < locations.Num(); ++idx)
+		{
+			keys[idx] = MortonKey(locations[idx], cellSize);
+			outOrder[idx] = idx;
+		}
+
+		Algo::SortBy(outOrder, [&keys](int32 idx) { return keys[idx]; });
+	}
+}
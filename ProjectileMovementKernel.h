@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FMassForceFragment;
+struct FMassVelocityFragment;
+struct FProjectileDragFragment;
+struct FProjectileRelativeStateFragment;
+struct FProjectileStateFragment;
+
+namespace UE::Projectiles::Kernel
+{
+	// Applies force, gravity, drag and the speed cap to a whole chunk's velocities in one pass
+	LYRAGAME_API void IntegrateVelocities(TArrayView<FMassVelocityFragment> velocities, TConstArrayView<FMassForceFragment> forces, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime);
+
+	// Plain scalar version of the above for a single velocity, kept as the reference other modes are validated against
+	LYRAGAME_API void IntegrateVelocityReference(FVector& velocity, const FVector& force, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime);
+
+	// Compact state equivalents of IntegrateVelocities, these layouts carry no force
+	LYRAGAME_API void IntegrateStates(TArrayView<FProjectileStateFragment> states, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime);
+	LYRAGAME_API void IntegrateStates(TArrayView<FProjectileRelativeStateFragment> states, const FVector& gravity, const FProjectileDragFragment* drag, float deltaTime);
+
+	// Octahedral encoding of a unit vector into 16 bits per axis, good to ~0.005 degrees
+	LYRAGAME_API uint32 PackDirection(const FVector3f& direction);
+	LYRAGAME_API FVector3f UnpackDirection(uint32 packedDirection);
+
+	// Z-order curve key of the grid cell a location falls in, nearby cells get nearby keys
+	LYRAGAME_API uint64 MortonKey(const FVector& location, float cellSize);
+
+	// Fills outOrder with 0..Num-1 sorted by the Morton key of each location
+	LYRAGAME_API void SortByMortonKey(TConstArrayView<FVector> locations, float cellSize, TArray<int32>& outOrder);
+}
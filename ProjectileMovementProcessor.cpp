@@ -9,6 +9,92 @@
 #include "MassMovementFragments.h"
 #include "MassSignalSubsystem.h"
 #include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileMovementKernel.h"
+#include "Mass/ProjectileSpatialIndexSubsystem.h"
+
+namespace ProjectileMovement
+{
+	static bool bFeedSpatialIndex = true;
+	static FAutoConsoleVariableRef CVarFeedSpatialIndex(
+		TEXT("Projectiles.SpatialIndex.Enabled"),
+		bFeedSpatialIndex,
+		TEXT("Whether the movement processor feeds each frame's projectile paths into the spatial index"));
+
+	static bool bMortonSweepOrder = true;
+	static FAutoConsoleVariableRef CVarMortonSweepOrder(
+		TEXT("Projectiles.SweepOrder.Enabled"),
+		bMortonSweepOrder,
+		TEXT("Sweep each chunk's projectiles in Morton order rather than spawn order, so consecutive sweeps touch nearby parts of the physics scene"));
+
+	static float SweepOrderCellSize = 500.f;
+	static FAutoConsoleVariableRef CVarSweepOrderCellSize(
+		TEXT("Projectiles.SweepOrder.CellSize"),
+		SweepOrderCellSize,
+		TEXT("Grid cell size the Morton sweep order is quantised to, in cm. Clamped to at least 1"));
+
+	static int32 SweepOrderResortInterval = 8;
+	static FAutoConsoleVariableRef CVarSweepOrderResortInterval(
+		TEXT("Projectiles.SweepOrder.ResortInterval"),
+		SweepOrderResortInterval,
+		TEXT("Frames between re-sorting a chunk's sweep order, chunks whose entity count changed are re-sorted immediately"));
+
+	// Per-layout access for the shared sweep loop, see EProjectileStateLayout
+	struct FTransformLayout
+	{
+		TArrayView<FTransformFragment> Transforms;
+		TArrayView<const FMassVelocityFragment> Velocities;
+
+		int32 Num() const { return Transforms.Num(); }
+		FVector GetPosition(int32 idx) const { return Transforms[idx].GetTransform().GetTranslation(); }
+		void SetPosition(int32 idx, const FVector& position) { Transforms[idx].GetMutableTransform().SetTranslation(position); }
+		FVector GetVelocity(int32 idx) const { return Velocities[idx].Value; }
+	};
+
+	template<typename TState>
+	struct TCompactLayout
+	{
+		TArrayView<TState> States;
+
+		int32 Num() const { return States.Num(); }
+		FVector GetPosition(int32 idx) const { return States[idx].GetPosition(); }
+		void SetPosition(int32 idx, const FVector& position) { States[idx].SetPosition(position); }
+		FVector GetVelocity(int32 idx) const { return States[idx].GetVelocity(); }
+	};
+
+	// Keeps the chunk's sweep order up to date, returns an empty view when sweeping in storage order
+	template<typename TLayout>
+	static TConstArrayView<int32> UpdateSweepOrder(FProjectileSweepOrderChunkFragment& sweepOrder, const TLayout& layout)
+	{
+		const int32 numEntities = layout.Num();
+		if (!bMortonSweepOrder || numEntities < 2)
+		{
+			return TConstArrayView<int32>();
+		}
+
+		// Entities added or removed since the last sort, the old order might not even be a valid permutation anymore
+		if (sweepOrder.Order.Num() != numEntities)
+		{
+			sweepOrder.FramesUntilResort = 0;
+		}
+
+		if (--sweepOrder.FramesUntilResort <= 0)
+		{
+			QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileMovementProcessor_SortSweepOrder);
+
+			TArray<FVector, TInlineAllocator<256>> locations;
+			locations.Reserve(numEntities);
+			for (int32 idx = 0; idx < numEntities; ++idx)
+			{
+				locations.Add(layout.GetPosition(idx));
+			}
+
+			UE::Projectiles::Kernel::SortByMortonKey(locations, FMath::Max(SweepOrderCellSize, 1.f), sweepOrder.Order);
+			sweepOrder.FramesUntilResort = SweepOrderResortInterval;
+		}
+
+		return sweepOrder.Order;
+	}
+}
 
 const FName UProjectileMovementProcessor::ProjectileEntityHitSignal = TEXT("ProjectileEntityHitSignal");
 
@@ -19,24 +105,48 @@ UProjectileMovementProcessor::UProjectileMovementProcessor()
 	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Movement;
 }
 
+void UProjectileMovementProcessor::Initialize(UObject& owner)
+{
+	Super::Initialize(owner);
+
+	UWorld* world = owner.GetWorld();
+	SpatialIndex = UWorld::GetSubsystem<UProjectileSpatialIndexSubsystem>(world);
+	LastWorldOrigin = world ? world->OriginLocation : FIntVector::ZeroValue;
+}
+
 void UProjectileMovementProcessor::ConfigureQueries()
 {
 	ProcessorRequirements.AddSubsystemRequirement<UMassSignalSubsystem>(EMassFragmentAccess::ReadWrite);
 
-	// Sweep and behaviour config
-	ProjectileMovementQuery.AddConstSharedRequirement<FProjectileArchetypeDescription>(EMassFragmentPresence::All);
-	ProjectileMovementQuery.AddConstSharedRequirement<FGravityScaleFragment>(EMassFragmentPresence::All);
+	for (FMassEntityQuery* query : { &ProjectileMovementQuery, &CompactMovementQuery, &RelativeMovementQuery })
+	{
+		// Sweep and behaviour config
+		query->AddConstSharedRequirement<FProjectileArchetypeDescription>(EMassFragmentPresence::All);
+		query->AddConstSharedRequirement<FGravityScaleFragment>(EMassFragmentPresence::All);
+		query->AddConstSharedRequirement<FProjectileDragFragment>(EMassFragmentPresence::Optional);
+		query->AddTagRequirement<FProjectileDormantTag>(EMassFragmentPresence::None);
+
+		query->AddRequirement<FCollisionIgnoredFragment>(EMassFragmentAccess::ReadOnly);
+		query->AddChunkRequirement<FProjectileSweepOrderChunkFragment>(EMassFragmentAccess::ReadWrite);
+
+		// Hit output
+		query->AddRequirement<FHitInfoFragment>(EMassFragmentAccess::ReadWrite);
+	}
 
-	// "Physics" sim
+	// "Physics" sim, one query per state layout
 	ProjectileMovementQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
 	ProjectileMovementQuery.AddRequirement<FMassForceFragment>(EMassFragmentAccess::ReadOnly);
 	ProjectileMovementQuery.AddRequirement<FMassVelocityFragment>(EMassFragmentAccess::ReadWrite);
-	ProjectileMovementQuery.AddRequirement<FCollisionIgnoredFragment>(EMassFragmentAccess::ReadOnly);
+	CompactMovementQuery.AddRequirement<FProjectileStateFragment>(EMassFragmentAccess::ReadWrite);
+	RelativeMovementQuery.AddRequirement<FProjectileRelativeStateFragment>(EMassFragmentAccess::ReadWrite);
+
+	DormantRelativeQuery.AddRequirement<FProjectileRelativeStateFragment>(EMassFragmentAccess::ReadWrite);
+	DormantRelativeQuery.AddTagRequirement<FProjectileDormantTag>(EMassFragmentPresence::All);
 
-	// Hit output
-	ProjectileMovementQuery.AddRequirement<FHitInfoFragment>(EMassFragmentAccess::ReadWrite);
-	
 	ProjectileMovementQuery.RegisterWithProcessor(*this);
+	CompactMovementQuery.RegisterWithProcessor(*this);
+	RelativeMovementQuery.RegisterWithProcessor(*this);
+	DormantRelativeQuery.RegisterWithProcessor(*this);
 }
 
 void UProjectileMovementProcessor::Execute(FMassEntityManager& entityManager, FMassExecutionContext& context)
@@ -46,48 +156,40 @@ void UProjectileMovementProcessor::Execute(FMassEntityManager& entityManager, FM
 	TQueue<FMassEntityHandle, EQueueMode::Mpsc> entitiesWithHits;
 	std::atomic<int32> numEntitiesWithHits = 0;
 
-	// Process entities
-	ProjectileMovementQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
-		QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileMovementProcessor_ProcessChunk);
+	const bool bFeedSpatialIndex = SpatialIndex && ProjectileMovement::bFeedSpatialIndex;
+	FrameSegments.Reset();
 
+	UWorld* world = context.GetWorld();
+
+	// Origin relative positions follow the world when it's rebased, same as actors do
+	const FVector3f originShift(FVector(LastWorldOrigin - world->OriginLocation));
+	LastWorldOrigin = world->OriginLocation;
+
+	// Shared by every state layout, sweeps each entity along its already integrated velocity
+	auto sweepChunk = [&](FMassExecutionContext& context, auto& layout)
+	{
 		const float deltaTime = context.GetDeltaTimeSeconds();
 		const int32 numEntities = context.GetNumEntities();
 
-		UWorld* world = context.GetWorld();
-
-		// Shared frags
 		const FProjectileArchetypeDescription& archetypeDescription = context.GetConstSharedFragment<FProjectileArchetypeDescription>();
-		const FGravityScaleFragment& gravityScale = context.GetConstSharedFragment<FGravityScaleFragment>();
-
-		// Per-entity frags
-		TArrayView<FTransformFragment> transforms = context.GetMutableFragmentView<FTransformFragment>();
-		TArrayView<const FMassForceFragment> forces = context.GetFragmentView<FMassForceFragment>();
-		TArrayView<FMassVelocityFragment> velocities = context.GetMutableFragmentView<FMassVelocityFragment>();
 		TArrayView<FHitInfoFragment> hitInfos = context.GetMutableFragmentView<FHitInfoFragment>();
 		TArrayView<const FCollisionIgnoredFragment> collisionIgnoredFrags = context.GetFragmentView<FCollisionIgnoredFragment>();
 
-		const float gravityZ = world->GetGravityZ()*gravityScale.GravityScale;
-		const FVector gravity(0.f, 0.f, gravityZ);
-
 		FCollisionQueryParams params;
 		params.bReturnPhysicalMaterial = true;
 
 		FCollisionShape sweepShape = FCollisionShape::MakeSphere(archetypeDescription.SweepRadius);
 
-		for (int32 idx = 0; idx < numEntities; ++idx)
+		const TConstArrayView<int32> sweepOrder = ProjectileMovement::UpdateSweepOrder(context.GetMutableChunkFragment<FProjectileSweepOrderChunkFragment>(), layout);
+
+		for (int32 orderIdx = 0; orderIdx < numEntities; ++orderIdx)
 		{
-			FTransform& transform = transforms[idx].GetMutableTransform();
-			const FVector& force = forces[idx].Value;
-			FVector& velocity = velocities[idx].Value;
+			const int32 idx = sweepOrder.Num() > 0 ? sweepOrder[orderIdx] : orderIdx;
+			const FVector velocity = layout.GetVelocity(idx);
 			FHitResult& hit = hitInfos[idx].HitInfo;
 			const FCollisionIgnoredFragment& ignored = collisionIgnoredFrags[idx];
 
-			const FVector& startPos = transform.GetTranslation();
-
-			// Add force to velocity
-			// TODO: handle max speed?
-			velocity += force * deltaTime;
-			velocity += gravity * deltaTime;
+			const FVector startPos = layout.GetPosition(idx);
 
 			// Predict end position
 			const FVector endPos = startPos + (velocity * deltaTime);
@@ -100,12 +202,12 @@ void UProjectileMovementProcessor::Execute(FMassEntityManager& entityManager, FM
 			for (const auto& comp : ignored.IgnoredComponents)
 				params.AddIgnoredComponent(comp.Get());
 
-			if (world->SweepSingleByChannel(hit, startPos, endPos, transform.GetRotation(), archetypeDescription.CollisionChannel, sweepShape, params))
+			if (world->SweepSingleByChannel(hit, startPos, endPos, FQuat::Identity, archetypeDescription.CollisionChannel, sweepShape, params))
 			{
 				// Hit something
 
 				// Not impact point, which is the point on the hit surface the sweep touched
-				transform.SetTranslation(hit.Location);
+				layout.SetPosition(idx, hit.Location);
 
 				// Push hit entity
 				entitiesWithHits.Enqueue(context.GetEntity(idx));
@@ -113,17 +215,76 @@ void UProjectileMovementProcessor::Execute(FMassEntityManager& entityManager, FM
 			}
 			else // Unblocked movement
 			{
-				transform.SetTranslation(endPos);
+				layout.SetPosition(idx, endPos);
 			}
 
-			// I can see why you might want this to be a tag which you run through a second processor, since branching in this loop feels evil
-			if (archetypeDescription.bRotationFollowsVelocity)
+			if (bFeedSpatialIndex)
 			{
-				transform.SetRotation(velocity.ToOrientationQuat());
+				FrameSegments.Add({ startPos, layout.GetPosition(idx), FVector3f(velocity), context.GetEntity(idx) });
 			}
 		}
+	};
+
+	auto getGravity = [world](FMassExecutionContext& context)
+	{
+		return FVector(0.f, 0.f, world->GetGravityZ() * context.GetConstSharedFragment<FGravityScaleFragment>().GravityScale);
+	};
+
+	// Process entities
+	ProjectileMovementQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileMovementProcessor_ProcessChunk);
+
+		TArrayView<FMassVelocityFragment> velocities = context.GetMutableFragmentView<FMassVelocityFragment>();
+
+		// Integrate the whole chunk's velocities up front so the sweep loop is just sweeps
+		UE::Projectiles::Kernel::IntegrateVelocities(velocities, context.GetFragmentView<FMassForceFragment>(), getGravity(context), context.GetConstSharedFragmentPtr<FProjectileDragFragment>(), context.GetDeltaTimeSeconds());
+
+		ProjectileMovement::FTransformLayout layout{ context.GetMutableFragmentView<FTransformFragment>(), velocities };
+		sweepChunk(context, layout);
 	});
 
+	CompactMovementQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileMovementProcessor_ProcessCompactChunk);
+
+		TArrayView<FProjectileStateFragment> states = context.GetMutableFragmentView<FProjectileStateFragment>();
+		UE::Projectiles::Kernel::IntegrateStates(states, getGravity(context), context.GetConstSharedFragmentPtr<FProjectileDragFragment>(), context.GetDeltaTimeSeconds());
+
+		ProjectileMovement::TCompactLayout<FProjectileStateFragment> layout{ states };
+		sweepChunk(context, layout);
+	});
+
+	RelativeMovementQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileMovementProcessor_ProcessRelativeChunk);
+
+		TArrayView<FProjectileRelativeStateFragment> states = context.GetMutableFragmentView<FProjectileRelativeStateFragment>();
+		if (!originShift.IsZero())
+		{
+			for (FProjectileRelativeStateFragment& state : states)
+			{
+				state.Position += originShift;
+			}
+		}
+		UE::Projectiles::Kernel::IntegrateStates(states, getGravity(context), context.GetConstSharedFragmentPtr<FProjectileDragFragment>(), context.GetDeltaTimeSeconds());
+
+		ProjectileMovement::TCompactLayout<FProjectileRelativeStateFragment> layout{ states };
+		sweepChunk(context, layout);
+	});
+
+	if (!originShift.IsZero())
+	{
+		DormantRelativeQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+			for (FProjectileRelativeStateFragment& state : context.GetMutableFragmentView<FProjectileRelativeStateFragment>())
+			{
+				state.Position += originShift;
+			}
+		});
+	}
+
+	if (bFeedSpatialIndex)
+	{
+		SpatialIndex->Rebuild(FrameSegments);
+	}
+
 	if (numEntitiesWithHits > 0)
 	{
 		// Signal that we have hits
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "MassProcessor.h"
+#include "Mass/ProjectileSpatialIndexSubsystem.h"
 #include "ProjectileMovementProcessor.generated.h"
 
 /**
@@ -19,9 +20,24 @@ public:
 	static const FName ProjectileEntityHitSignal;
 
 protected:
+	virtual void Initialize(UObject& owner) override;
 	virtual void ConfigureQueries() override;
 	virtual void Execute(FMassEntityManager& entityManager, FMassExecutionContext& context) override;
 
+	// One query per EProjectileStateLayout
 	FMassEntityQuery ProjectileMovementQuery;
+	FMassEntityQuery CompactMovementQuery;
+	FMassEntityQuery RelativeMovementQuery;
+	// Sleeping relative layout projectiles don't move, but still have to follow origin rebases
+	FMassEntityQuery DormantRelativeQuery;
+
+	// World origin FProjectileRelativeStateFragment positions were last relative to
+	FIntVector LastWorldOrigin = FIntVector::ZeroValue;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileSpatialIndexSubsystem> SpatialIndex;
+
+	// Handed to the spatial index each frame, which swaps it for last frame's buffer
+	TArray<FProjectileSegment> FrameSegments;
 
 };
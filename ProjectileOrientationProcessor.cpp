@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileOrientationProcessor.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "MassMovementFragments.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileMovementProcessor.h"
+
+UProjectileOrientationProcessor::UProjectileOrientationProcessor()
+{
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Client | EProcessorExecutionFlags::Standalone);
+
+	ExecutionOrder.ExecuteAfter.Add(UProjectileMovementProcessor::StaticClass()->GetFName());
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Movement;
+}
+
+void UProjectileOrientationProcessor::ConfigureQueries()
+{
+	OrientationQuery.AddConstSharedRequirement<FProjectileArchetypeDescription>(EMassFragmentPresence::All);
+	OrientationQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
+	OrientationQuery.AddRequirement<FMassVelocityFragment>(EMassFragmentAccess::ReadOnly);
+	OrientationQuery.AddTagRequirement<FProjectileServerOnlyTag>(EMassFragmentPresence::None);
+
+	OrientationQuery.RegisterWithProcessor(*this);
+}
+
+void UProjectileOrientationProcessor::Execute(FMassEntityManager& entityManager, FMassExecutionContext& context)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileOrientationProcessor_Execute);
+
+	OrientationQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		// Whole chunk shares the archetype description, so this is one branch per chunk rather than per entity
+		if (!context.GetConstSharedFragment<FProjectileArchetypeDescription>().bRotationFollowsVelocity)
+		{
+			return;
+		}
+
+		const int32 numEntities = context.GetNumEntities();
+		TArrayView<FTransformFragment> transforms = context.GetMutableFragmentView<FTransformFragment>();
+		TArrayView<const FMassVelocityFragment> velocities = context.GetFragmentView<FMassVelocityFragment>();
+
+		for (int32 idx = 0; idx < numEntities; ++idx)
+		{
+			transforms[idx].GetMutableTransform().SetRotation(velocities[idx].Value.ToOrientationQuat());
+		}
+	});
+}
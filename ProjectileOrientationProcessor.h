@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "ProjectileOrientationProcessor.generated.h"
+
+/**
+ * Points projectiles along their velocity, purely visual so servers skip it
+ */
+UCLASS()
+class LYRAGAME_API UProjectileOrientationProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UProjectileOrientationProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& entityManager, FMassExecutionContext& context) override;
+
+	FMassEntityQuery OrientationQuery;
+};
@@ -0,0 +1,279 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileSpatialIndexSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+namespace ProjectileSpatialIndex
+{
+	static float CellSize = 1000.f;
+	static FAutoConsoleVariableRef CVarCellSize(
+		TEXT("Projectiles.SpatialIndex.CellSize"),
+		CellSize,
+		TEXT("Edge length of the projectile spatial index grid cells, in cm"));
+
+	static int32 MaxCellsPerSegment = 64;
+	static FAutoConsoleVariableRef CVarMaxCellsPerSegment(
+		TEXT("Projectiles.SpatialIndex.MaxCellsPerSegment"),
+		MaxCellsPerSegment,
+		TEXT("Segments overlapping more cells than this skip the grid and are tested by every query"));
+
+	static int32 MinQueriesPerTask = 32;
+	static FAutoConsoleVariableRef CVarMinQueriesPerTask(
+		TEXT("Projectiles.SpatialIndex.MinQueriesPerTask"),
+		MinQueriesPerTask,
+		TEXT("Batched queries are split across worker threads in blocks of at least this many"));
+
+	static FIntVector ToCell(const FVector& location, float invCellSize)
+	{
+		return FIntVector(
+			FMath::FloorToInt(location.X * invCellSize),
+			FMath::FloorToInt(location.Y * invCellSize),
+			FMath::FloorToInt(location.Z * invCellSize));
+	}
+
+	static uint64 MakeCellKey(int32 x, int32 y, int32 z)
+	{
+		// 21 bits per axis is plenty at any sensible cell size
+		constexpr uint64 mask = (1ull << 21) - 1;
+		return ((uint64)x & mask) | (((uint64)y & mask) << 21) | (((uint64)z & mask) << 42);
+	}
+
+	static int64 CountCells(const FIntVector& minCell, const FIntVector& maxCell)
+	{
+		return (int64)(maxCell.X - minCell.X + 1) * (maxCell.Y - minCell.Y + 1) * (maxCell.Z - minCell.Z + 1);
+	}
+
+	static FProjectileSpatialQueryHit MakeHit(const FProjectileSegment& segment, const FVector& closestPoint, float distance)
+	{
+		FProjectileSpatialQueryHit hit;
+		hit.Entity = segment.Entity;
+		hit.ClosestPointOnPath = closestPoint;
+		hit.Distance = distance;
+		hit.Velocity = FVector(segment.Velocity);
+
+		const FVector path = segment.End - segment.Start;
+		const double pathLengthSq = path.SizeSquared();
+		hit.PathAlpha = pathLengthSq > UE_SMALL_NUMBER ? (float)(FVector::DotProduct(closestPoint - segment.Start, path) / pathLengthSq) : 0.f;
+		return hit;
+	}
+}
+
+void UProjectileSpatialIndexSubsystem::Rebuild(TArray<FProjectileSegment>& segments)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpatialIndex_Rebuild);
+
+	// Readers only ever look at ReadGridIndex, so the other grid is ours until we swap
+	FGrid& grid = Grids[1 - ReadGridIndex];
+	Swap(grid.Segments, segments);
+	segments.Reset();
+
+	grid.CellSize = FMath::Max(ProjectileSpatialIndex::CellSize, 1.f);
+	grid.CellSegmentIndices.Reset();
+	grid.CellRanges.Reset();
+	grid.OversizedSegmentIndices.Reset();
+
+	const float invCellSize = 1.f / grid.CellSize;
+
+	TArray<TPair<uint64, int32>> cellEntries;
+	cellEntries.Reserve(grid.Segments.Num() * 2);
+
+	for (int32 segmentIdx = 0; segmentIdx < grid.Segments.Num(); ++segmentIdx)
+	{
+		const FProjectileSegment& segment = grid.Segments[segmentIdx];
+		const FIntVector minCell = ProjectileSpatialIndex::ToCell(segment.Start.ComponentMin(segment.End), invCellSize);
+		const FIntVector maxCell = ProjectileSpatialIndex::ToCell(segment.Start.ComponentMax(segment.End), invCellSize);
+
+		if (ProjectileSpatialIndex::CountCells(minCell, maxCell) > ProjectileSpatialIndex::MaxCellsPerSegment)
+		{
+			grid.OversizedSegmentIndices.Add(segmentIdx);
+			continue;
+		}
+
+		for (int32 x = minCell.X; x <= maxCell.X; ++x)
+		for (int32 y = minCell.Y; y <= maxCell.Y; ++y)
+		for (int32 z = minCell.Z; z <= maxCell.Z; ++z)
+		{
+			cellEntries.Emplace(ProjectileSpatialIndex::MakeCellKey(x, y, z), segmentIdx);
+		}
+	}
+
+	Algo::SortBy(cellEntries, [](const TPair<uint64, int32>& entry) { return entry.Key; });
+
+	grid.CellSegmentIndices.SetNumUninitialized(cellEntries.Num());
+	for (int32 entryIdx = 0; entryIdx < cellEntries.Num(); ++entryIdx)
+	{
+		const uint64 cellKey = cellEntries[entryIdx].Key;
+		grid.CellSegmentIndices[entryIdx] = cellEntries[entryIdx].Value;
+
+		if (entryIdx == 0 || cellEntries[entryIdx - 1].Key != cellKey)
+		{
+			grid.CellRanges.Add(cellKey, TPair<int32, int32>(entryIdx, 1));
+		}
+		else
+		{
+			++grid.CellRanges.FindChecked(cellKey).Value;
+		}
+	}
+
+	FRWScopeLock lock(ReadGridLock, SLT_Write);
+	ReadGridIndex = 1 - ReadGridIndex;
+}
+
+void UProjectileSpatialIndexSubsystem::GatherCandidates(const FGrid& grid, const FBox& bounds, TArray<int32>& outCandidates) const
+{
+	outCandidates.Reset();
+
+	const float invCellSize = 1.f / grid.CellSize;
+	const FIntVector minCell = ProjectileSpatialIndex::ToCell(bounds.Min, invCellSize);
+	const FIntVector maxCell = ProjectileSpatialIndex::ToCell(bounds.Max, invCellSize);
+
+	if (ProjectileSpatialIndex::CountCells(minCell, maxCell) > grid.CellRanges.Num())
+	{
+		// Query covers more cells than are occupied, cheaper to just test everything
+		for (int32 segmentIdx = 0; segmentIdx < grid.Segments.Num(); ++segmentIdx)
+		{
+			outCandidates.Add(segmentIdx);
+		}
+		return;
+	}
+
+	for (int32 x = minCell.X; x <= maxCell.X; ++x)
+	for (int32 y = minCell.Y; y <= maxCell.Y; ++y)
+	for (int32 z = minCell.Z; z <= maxCell.Z; ++z)
+	{
+		if (const TPair<int32, int32>* range = grid.CellRanges.Find(ProjectileSpatialIndex::MakeCellKey(x, y, z)))
+		{
+			outCandidates.Append(&grid.CellSegmentIndices[range->Key], range->Value);
+		}
+	}
+	outCandidates.Append(grid.OversizedSegmentIndices);
+
+	// Segments spanning several cells show up once per cell
+	Algo::Sort(outCandidates);
+	outCandidates.SetNum(Algo::Unique(outCandidates), false);
+}
+
+template<typename TQuery, typename TBoundsFunc, typename TTestFunc>
+void UProjectileSpatialIndexSubsystem::RunQueries(TConstArrayView<TQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults, TBoundsFunc&& boundsFunc, TTestFunc&& testFunc) const
+{
+	outResults.SetNum(queries.Num());
+
+	FRWScopeLock lock(ReadGridLock, SLT_ReadOnly);
+	const FGrid& grid = Grids[ReadGridIndex];
+
+	const int32 numQueries = queries.Num();
+	const int32 numTasks = FMath::Max(1, numQueries / FMath::Max(ProjectileSpatialIndex::MinQueriesPerTask, 1));
+	const int32 queriesPerTask = FMath::DivideAndRoundUp(numQueries, numTasks);
+
+	ParallelFor(numTasks, [&](int32 taskIdx)
+	{
+		TArray<int32> candidates;
+
+		const int32 firstQuery = taskIdx * queriesPerTask;
+		const int32 lastQuery = FMath::Min(firstQuery + queriesPerTask, numQueries);
+		for (int32 queryIdx = firstQuery; queryIdx < lastQuery; ++queryIdx)
+		{
+			const TQuery& query = queries[queryIdx];
+			TArray<FProjectileSpatialQueryHit>& hits = outResults[queryIdx].Hits;
+			hits.Reset();
+
+			GatherCandidates(grid, boundsFunc(query), candidates);
+			for (const int32 segmentIdx : candidates)
+			{
+				testFunc(query, grid.Segments[segmentIdx], hits);
+			}
+		}
+	}, numTasks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void UProjectileSpatialIndexSubsystem::QuerySpheres(TConstArrayView<FProjectileSphereQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpatialIndex_QuerySpheres);
+
+	RunQueries(queries, outResults,
+		[](const FProjectileSphereQuery& query)
+		{
+			return FBox(query.Center - FVector(query.Radius), query.Center + FVector(query.Radius));
+		},
+		[](const FProjectileSphereQuery& query, const FProjectileSegment& segment, TArray<FProjectileSpatialQueryHit>& outHits)
+		{
+			const FVector closestPoint = FMath::ClosestPointOnSegment(query.Center, segment.Start, segment.End);
+			const double distanceSq = FVector::DistSquared(closestPoint, query.Center);
+			if (distanceSq <= FMath::Square(query.Radius))
+			{
+				outHits.Add(ProjectileSpatialIndex::MakeHit(segment, closestPoint, FMath::Sqrt(distanceSq)));
+			}
+		});
+}
+
+void UProjectileSpatialIndexSubsystem::QueryCapsules(TConstArrayView<FProjectileCapsuleQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpatialIndex_QueryCapsules);
+
+	RunQueries(queries, outResults,
+		[](const FProjectileCapsuleQuery& query)
+		{
+			FBox bounds(query.Start.ComponentMin(query.End), query.Start.ComponentMax(query.End));
+			return bounds.ExpandBy(query.Radius);
+		},
+		[](const FProjectileCapsuleQuery& query, const FProjectileSegment& segment, TArray<FProjectileSpatialQueryHit>& outHits)
+		{
+			FVector closestOnPath, closestOnCapsule;
+			FMath::SegmentDistToSegmentSafe(segment.Start, segment.End, query.Start, query.End, closestOnPath, closestOnCapsule);
+			const double distanceSq = FVector::DistSquared(closestOnPath, closestOnCapsule);
+			if (distanceSq <= FMath::Square(query.Radius))
+			{
+				outHits.Add(ProjectileSpatialIndex::MakeHit(segment, closestOnPath, FMath::Sqrt(distanceSq)));
+			}
+		});
+}
+
+void UProjectileSpatialIndexSubsystem::QueryCones(TConstArrayView<FProjectileConeQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpatialIndex_QueryCones);
+
+	RunQueries(queries, outResults,
+		[](const FProjectileConeQuery& query)
+		{
+			const FVector tip = query.Origin + query.Direction * query.Length;
+			const float endRadius = query.Length * FMath::Tan(FMath::DegreesToRadians(query.HalfAngleDegrees));
+			FBox bounds(query.Origin.ComponentMin(tip), query.Origin.ComponentMax(tip));
+			return bounds.ExpandBy(endRadius);
+		},
+		[](const FProjectileConeQuery& query, const FProjectileSegment& segment, TArray<FProjectileSpatialQueryHit>& outHits)
+		{
+			const FVector axisEnd = query.Origin + query.Direction * query.Length;
+			const double tanHalfAngle = FMath::Tan(FMath::DegreesToRadians(query.HalfAngleDegrees));
+
+			// The point nearest the axis is the best bet for being inside, endpoints cover paths entering/leaving through the sides
+			FVector nearestToAxis, nearestOnAxis;
+			FMath::SegmentDistToSegmentSafe(segment.Start, segment.End, query.Origin, axisEnd, nearestToAxis, nearestOnAxis);
+			const FVector candidates[] = { nearestToAxis, segment.Start, segment.End };
+
+			for (const FVector& candidate : candidates)
+			{
+				const FVector toCandidate = candidate - query.Origin;
+				const double alongAxis = FVector::DotProduct(toCandidate, query.Direction);
+				if (alongAxis < 0.0 || alongAxis > query.Length)
+				{
+					continue;
+				}
+
+				const double fromAxis = (toCandidate - query.Direction * alongAxis).Size();
+				if (fromAxis <= alongAxis * tanHalfAngle)
+				{
+					outHits.Add(ProjectileSpatialIndex::MakeHit(segment, candidate, fromAxis));
+					break;
+				}
+			}
+		});
+}
+
+void UProjectileSpatialIndexSubsystem::BP_QuerySphere(const FProjectileSphereQuery& query, TArray<FProjectileSpatialQueryHit>& outHits) const
+{
+	TArray<FProjectileSpatialQueryResult> results;
+	QuerySpheres(MakeArrayView(&query, 1), results);
+	outHits = MoveTemp(results[0].Hits);
+}
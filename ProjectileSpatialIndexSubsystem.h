@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Mass/MassHelpers.h"
+#include "ProjectileSpatialIndexSubsystem.generated.h"
+
+// Path a projectile travelled this frame
+struct FProjectileSegment
+{
+	FVector Start;
+	FVector End;
+	FVector3f Velocity;
+	FMassEntityHandle Entity;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectileSphereQuery
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Center = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Radius = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectileCapsuleQuery
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Start = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector End = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Radius = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectileConeQuery
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Origin = FVector::ZeroVector;
+
+	// Expected to be normalized
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Direction = FVector::ForwardVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Length = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float HalfAngleDegrees = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectileSpatialQueryHit
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FMassEntityHandleWrapper Entity;
+
+	// Closest point on the projectile's path this frame to the query shape
+	UPROPERTY(BlueprintReadOnly)
+	FVector ClosestPointOnPath = FVector::ZeroVector;
+
+	// Distance from the query shape (sphere centre, capsule segment, cone axis) at the closest point
+	UPROPERTY(BlueprintReadOnly)
+	float Distance = 0.f;
+
+	// How far along this frame's path the closest point is, 0 = start, 1 = end
+	UPROPERTY(BlueprintReadOnly)
+	float PathAlpha = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector Velocity = FVector::ZeroVector;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectileSpatialQueryResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FProjectileSpatialQueryHit> Hits;
+};
+
+/**
+ * Uniform grid over the segments live projectiles travelled this frame
+ * Fed by UProjectileMovementProcessor, queries can come from any thread
+ */
+UCLASS()
+class LYRAGAME_API UProjectileSpatialIndexSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Takes ownership of the frame's segments, leaving the previous frame's (emptied) array in their place
+	void Rebuild(TArray<FProjectileSegment>& segments);
+
+	void QuerySpheres(TConstArrayView<FProjectileSphereQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults) const;
+	void QueryCapsules(TConstArrayView<FProjectileCapsuleQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults) const;
+	void QueryCones(TConstArrayView<FProjectileConeQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Projectile Spatial Index", meta = (DisplayName = "Query Projectiles (spheres)"))
+	void BP_QuerySpheres(const TArray<FProjectileSphereQuery>& queries, TArray<FProjectileSpatialQueryResult>& outResults) const { QuerySpheres(queries, outResults); }
+	UFUNCTION(BlueprintCallable, Category = "Projectile Spatial Index", meta = (DisplayName = "Query Projectiles (capsules)"))
+	void BP_QueryCapsules(const TArray<FProjectileCapsuleQuery>& queries, TArray<FProjectileSpatialQueryResult>& outResults) const { QueryCapsules(queries, outResults); }
+	UFUNCTION(BlueprintCallable, Category = "Projectile Spatial Index", meta = (DisplayName = "Query Projectiles (cones)"))
+	void BP_QueryCones(const TArray<FProjectileConeQuery>& queries, TArray<FProjectileSpatialQueryResult>& outResults) const { QueryCones(queries, outResults); }
+
+	UFUNCTION(BlueprintCallable, Category = "Projectile Spatial Index", meta = (DisplayName = "Query Projectiles (sphere)"))
+	void BP_QuerySphere(const FProjectileSphereQuery& query, TArray<FProjectileSpatialQueryHit>& outHits) const;
+
+protected:
+	struct FGrid
+	{
+		TArray<FProjectileSegment> Segments;
+		// Segment indices sorted by cell, CellRanges maps a cell key to its slice of this
+		TArray<int32> CellSegmentIndices;
+		TMap<uint64, TPair<int32, int32>> CellRanges;
+		// Segments spanning too many cells to insert, tested by every query
+		TArray<int32> OversizedSegmentIndices;
+		float CellSize = 1.f;
+	};
+
+	template<typename TQuery, typename TBoundsFunc, typename TTestFunc>
+	void RunQueries(TConstArrayView<TQuery> queries, TArray<FProjectileSpatialQueryResult>& outResults, TBoundsFunc&& boundsFunc, TTestFunc&& testFunc) const;
+
+	void GatherCandidates(const FGrid& grid, const FBox& bounds, TArray<int32>& outCandidates) const;
+
+	FGrid Grids[2];
+	int32 ReadGridIndex = 0;
+	mutable FRWLock ReadGridLock;
+};
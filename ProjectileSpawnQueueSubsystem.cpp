@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileSpawnQueueSubsystem.h"
+#include "Mass/MassHelpers.h"
+#include "Mass/ProjectileCatalogSubsystem.h"
+#include "Mass/ProjectileStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued Spawns"), STAT_ProjectileSpawnQueue_Spawned, STATGROUP_LightweightProjectiles);
+
+FProjectileSpawnRequest::FProjectileSpawnRequest(const FProjectileSpawnParams& spawnParams)
+	: TypeId(spawnParams.TypeId >= 0 && spawnParams.TypeId < MAX_uint16 ? static_cast<uint16>(spawnParams.TypeId) : MAX_uint16)
+	, Transform(spawnParams.Transform)
+	, Velocity(spawnParams.Velocity)
+	, Instigator(spawnParams.Instigator)
+	, Owner(spawnParams.Owner)
+{
+	IgnoredActors.Reserve(spawnParams.IgnoredActors.Num());
+	for (AActor* actor : spawnParams.IgnoredActors)
+	{
+		IgnoredActors.Add(actor);
+	}
+}
+
+FProjectileSpawnParams FProjectileSpawnRequest::ToSpawnParams() const
+{
+	FProjectileSpawnParams spawnParams;
+	spawnParams.TypeId = TypeId;
+	spawnParams.Transform = Transform;
+	spawnParams.Velocity = Velocity;
+	spawnParams.Instigator = Instigator.Get();
+	spawnParams.Owner = Owner.Get();
+	spawnParams.IgnoredActors.Reserve(IgnoredActors.Num());
+	for (const TWeakObjectPtr<AActor>& actor : IgnoredActors)
+	{
+		if (AActor* ignoredActor = actor.Get())
+		{
+			spawnParams.IgnoredActors.Add(ignoredActor);
+		}
+	}
+	return spawnParams;
+}
+
+void UProjectileSpawnQueueSubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	// Spawning goes through the catalog's templates
+	collection.InitializeDependency<UProjectileCatalogSubsystem>();
+}
+
+void UProjectileSpawnQueueSubsystem::Enqueue(FProjectileSpawnRequest&& request)
+{
+	Requests.Enqueue(MoveTemp(request));
+}
+
+void UProjectileSpawnQueueSubsystem::Drain(TArray<FProjectileSpawnRequest>& outRequests)
+{
+	check(IsInGameThread());
+
+	FProjectileSpawnRequest request;
+	while (Requests.Dequeue(request))
+	{
+		outRequests.Add(MoveTemp(request));
+	}
+}
+
+void UProjectileSpawnQueueSubsystem::SpawnQueued()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpawnQueueSubsystem_Spawn);
+
+	if (IsEmpty())
+	{
+		return;
+	}
+
+	DrainedRequests.Reset();
+	Drain(DrainedRequests);
+
+	// Resolve the weak references now, while they're still what the requester meant
+	TArray<FProjectileSpawnParams> spawnParams;
+	spawnParams.Reserve(DrainedRequests.Num());
+	for (const FProjectileSpawnRequest& request : DrainedRequests)
+	{
+		spawnParams.Add(request.ToSpawnParams());
+	}
+
+	// No processor is running yet, so these can be created directly and join this frame's movement
+	const int32 numSpawned = UMassHelpers::SpawnProjectileBatch(GetWorld(), spawnParams);
+	INC_DWORD_STAT_BY(STAT_ProjectileSpawnQueue_Spawned, numSpawned);
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileSpawnQueueSubsystem.generated.h"
+
+struct FProjectileSpawnParams;
+
+// FProjectileSpawnParams without strong references, so requests can sit in the queue across a garbage collection
+struct FProjectileSpawnRequest
+{
+	uint16 TypeId = MAX_uint16;
+	FTransform Transform;
+	FVector Velocity = FVector::ZeroVector;
+	TWeakObjectPtr<AActor> Instigator;
+	TWeakObjectPtr<AActor> Owner;
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<2>> IgnoredActors;
+
+	FProjectileSpawnRequest() = default;
+	explicit FProjectileSpawnRequest(const FProjectileSpawnParams& spawnParams);
+
+	FProjectileSpawnParams ToSpawnParams() const;
+};
+
+/**
+ * Lets any thread request projectile spawns without going through the game thread.
+ * Drained by UProjectileBudgetSubsystem when the Mass PrePhysics phase starts, so everything requested since last frame
+ * is spawned one batch per projectile type, counts against this frame's budget and moves this frame
+ */
+UCLASS()
+class LYRAGAME_API UProjectileSpawnQueueSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+
+	// Safe to call from any thread, but look the subsystem up on the game thread and hold on to it
+	void Enqueue(FProjectileSpawnRequest&& request);
+	void Enqueue(const FProjectileSpawnParams& spawnParams) { Enqueue(FProjectileSpawnRequest(spawnParams)); }
+
+	// Game thread only
+	void Drain(TArray<FProjectileSpawnRequest>& outRequests);
+
+	bool IsEmpty() const { return Requests.IsEmpty(); }
+
+	// Drains and spawns everything queued, game thread only and before any processor runs
+	void SpawnQueued();
+
+protected:
+	TQueue<FProjectileSpawnRequest, EQueueMode::Mpsc> Requests;
+
+	// Kept around so draining doesn't reallocate every frame
+	TArray<FProjectileSpawnRequest> DrainedRequests;
+};
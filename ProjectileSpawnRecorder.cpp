@@ -0,0 +1,324 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileSpawnRecorder.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "MassEntitySubsystem.h"
+#include "MassSimulationSubsystem.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Mass/MassHelpers.h"
+#include "Mass/ProjectileCatalogSubsystem.h"
+#include "Mass/ProjectileStats.h"
+
+namespace ProjectileSpawnRecorder
+{
+	static FString GetDefaultRecordingFilename()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("ProjectileSpawns") / FString::Printf(TEXT("%s.pspawn"), *FDateTime::Now().ToString());
+	}
+
+	static FProjectileSpawnRecord MakeRecord(uint32 frame, uint16 typeId, const FTransform& transform, const FVector& velocity)
+	{
+		FProjectileSpawnRecord record;
+		record.Frame = frame;
+		record.TypeId = typeId;
+
+		const FVector location = transform.GetTranslation();
+		record.Location[0] = location.X;
+		record.Location[1] = location.Y;
+		record.Location[2] = location.Z;
+
+		const FQuat4f rotation(transform.GetRotation());
+		record.Rotation[0] = rotation.X;
+		record.Rotation[1] = rotation.Y;
+		record.Rotation[2] = rotation.Z;
+		record.Rotation[3] = rotation.W;
+
+		record.Velocity[0] = static_cast<float>(velocity.X);
+		record.Velocity[1] = static_cast<float>(velocity.Y);
+		record.Velocity[2] = static_cast<float>(velocity.Z);
+		return record;
+	}
+}
+
+void UProjectileSpawnRecorderSubsystem::Deinitialize()
+{
+	StopRecording();
+	StopReplay();
+
+	Super::Deinitialize();
+}
+
+bool UProjectileSpawnRecorderSubsystem::DoesSupportWorldType(EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
+
+TStatId UProjectileSpawnRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSpawnRecorderSubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileSpawnRecorderSubsystem::Tick(float deltaTime)
+{
+	Super::Tick(deltaTime);
+
+	if (IsReplaying())
+	{
+		TickReplay();
+	}
+}
+
+bool UProjectileSpawnRecorderSubsystem::StartRecording(const FString& filename)
+{
+	if (IsRecording() || IsReplaying())
+	{
+		UE_LOG(LogLightweightProjectiles, Warning, TEXT("Can't start recording projectile spawns, a recording or replay is already running"));
+		return false;
+	}
+
+	const FString& path = filename.IsEmpty() ? ProjectileSpawnRecorder::GetDefaultRecordingFilename() : filename;
+	RecordWriter.Reset(IFileManager::Get().CreateFileWriter(*path, FILEWRITE_AllowRead));
+	if (!RecordWriter)
+	{
+		UE_LOG(LogLightweightProjectiles, Error, TEXT("Failed to open %s for recording projectile spawns"), *path);
+		return false;
+	}
+
+	const UProjectileCatalogSubsystem* catalogSS = GetWorld()->GetSubsystem<UProjectileCatalogSubsystem>();
+
+	FProjectileSpawnRecordFileHeader header;
+	header.RecordSize = sizeof(FProjectileSpawnRecord);
+	header.NumCatalogTypes = catalogSS ? catalogSS->GetNumTypes() : 0;
+	RecordWriter->Serialize(&header, sizeof(header));
+
+	RecordStartFrame = GFrameCounter;
+	NumRecorded = 0;
+
+	if (UMassSimulationSubsystem* simulationSS = GetWorld()->GetSubsystem<UMassSimulationSubsystem>())
+	{
+		PhaseStartedHandle = simulationSS->GetOnProcessingPhaseStarted(EMassProcessingPhase::PrePhysics).AddUObject(this, &UProjectileSpawnRecorderSubsystem::OnPrePhysicsPhaseStarted);
+	}
+
+	UE_LOG(LogLightweightProjectiles, Log, TEXT("Recording projectile spawns to %s"), *path);
+	return true;
+}
+
+void UProjectileSpawnRecorderSubsystem::StopRecording()
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	if (UMassSimulationSubsystem* simulationSS = GetWorld()->GetSubsystem<UMassSimulationSubsystem>())
+	{
+		simulationSS->GetOnProcessingPhaseStarted(EMassProcessingPhase::PrePhysics).Remove(PhaseStartedHandle);
+	}
+	PhaseStartedHandle.Reset();
+
+	FlushDeferredRecords();
+	RecordWriter->Close();
+	RecordWriter.Reset();
+
+	UE_LOG(LogLightweightProjectiles, Log, TEXT("Stopped recording projectile spawns, %d spawns over %u frames"), NumRecorded, GetRecordingFrame());
+}
+
+uint32 UProjectileSpawnRecorderSubsystem::GetRecordingFrame() const
+{
+	return static_cast<uint32>(GFrameCounter - RecordStartFrame);
+}
+
+void UProjectileSpawnRecorderSubsystem::RecordSpawn(const FProjectileSpawnParams& spawnParams)
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	WriteRecord(ProjectileSpawnRecorder::MakeRecord(GetRecordingFrame(), static_cast<uint16>(spawnParams.TypeId), spawnParams.Transform, spawnParams.Velocity));
+}
+
+void UProjectileSpawnRecorderSubsystem::RecordSpawnDeferred(FMassEntityHandle entity, uint16 typeId)
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	DeferredRecords.Add({ entity, typeId, GetRecordingFrame() });
+}
+
+void UProjectileSpawnRecorderSubsystem::OnPrePhysicsPhaseStarted(float deltaSeconds)
+{
+	// Movement runs in this phase, so this is the last point the caller's initial state is still intact
+	FlushDeferredRecords();
+}
+
+void UProjectileSpawnRecorderSubsystem::FlushDeferredRecords()
+{
+	if (DeferredRecords.Num() == 0)
+	{
+		return;
+	}
+
+	const FMassEntityManager& entityManager = GetWorld()->GetSubsystem<UMassEntitySubsystem>()->GetEntityManager();
+	for (const FDeferredRecord& deferred : DeferredRecords)
+	{
+		if (!entityManager.IsEntityValid(deferred.Entity))
+		{
+			// Already gone before we got to see it, nothing worth replaying
+			continue;
+		}
+
+		const FMassEntityView view(entityManager, deferred.Entity);
+
+		FTransform transform;
+		UMassHelpers::GetProjectileTransform(view, transform);
+
+		FVector velocity = FVector::ZeroVector;
+		UMassHelpers::GetProjectileVelocity(view, velocity);
+
+		WriteRecord(ProjectileSpawnRecorder::MakeRecord(deferred.Frame, deferred.TypeId, transform, velocity));
+	}
+	DeferredRecords.Reset();
+}
+
+void UProjectileSpawnRecorderSubsystem::WriteRecord(const FProjectileSpawnRecord& record)
+{
+	RecordWriter->Serialize(const_cast<FProjectileSpawnRecord*>(&record), sizeof(record));
+	++NumRecorded;
+}
+
+bool UProjectileSpawnRecorderSubsystem::StartReplay(const FString& filename)
+{
+	if (IsRecording() || IsReplaying())
+	{
+		UE_LOG(LogLightweightProjectiles, Warning, TEXT("Can't start replaying projectile spawns, a recording or replay is already running"));
+		return false;
+	}
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filename));
+	if (!MappedFile)
+	{
+		UE_LOG(LogLightweightProjectiles, Error, TEXT("Failed to map %s for replaying projectile spawns"), *filename);
+		return false;
+	}
+
+	MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize(), true));
+	if (!MappedRegion || MappedRegion->GetMappedSize() < sizeof(FProjectileSpawnRecordFileHeader))
+	{
+		UE_LOG(LogLightweightProjectiles, Error, TEXT("%s is too small to be a projectile spawn recording"), *filename);
+		StopReplay();
+		return false;
+	}
+
+	const uint8* mappedPtr = MappedRegion->GetMappedPtr();
+	const FProjectileSpawnRecordFileHeader& header = *reinterpret_cast<const FProjectileSpawnRecordFileHeader*>(mappedPtr);
+	if (header.Magic != FProjectileSpawnRecordFileHeader::ExpectedMagic
+		|| header.Version != FProjectileSpawnRecordFileHeader::CurrentVersion
+		|| header.RecordSize != sizeof(FProjectileSpawnRecord))
+	{
+		UE_LOG(LogLightweightProjectiles, Error, TEXT("%s is not a compatible projectile spawn recording (version %u)"), *filename, header.Version);
+		StopReplay();
+		return false;
+	}
+
+	const UProjectileCatalogSubsystem* catalogSS = GetWorld()->GetSubsystem<UProjectileCatalogSubsystem>();
+	if (catalogSS == nullptr || catalogSS->GetNumTypes() != (int32)header.NumCatalogTypes)
+	{
+		UE_LOG(LogLightweightProjectiles, Warning, TEXT("Projectile catalog has changed since %s was recorded, type ids may not match"), *filename);
+	}
+
+	const int64 numRecords = (MappedRegion->GetMappedSize() - sizeof(FProjectileSpawnRecordFileHeader)) / sizeof(FProjectileSpawnRecord);
+	ReplayRecords = MakeArrayView(reinterpret_cast<const FProjectileSpawnRecord*>(mappedPtr + sizeof(FProjectileSpawnRecordFileHeader)), (int32)numRecords);
+	ReplayCursor = 0;
+	ReplayStartFrame = GFrameCounter;
+
+	UE_LOG(LogLightweightProjectiles, Log, TEXT("Replaying %d projectile spawns from %s"), ReplayRecords.Num(), *filename);
+	return true;
+}
+
+void UProjectileSpawnRecorderSubsystem::StopReplay()
+{
+	ReplayRecords = TConstArrayView<FProjectileSpawnRecord>();
+	ReplayCursor = 0;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+void UProjectileSpawnRecorderSubsystem::TickReplay()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpawnRecorder_TickReplay);
+
+	const uint32 replayFrame = static_cast<uint32>(GFrameCounter - ReplayStartFrame);
+	const UWorld* world = GetWorld();
+
+	FProjectileSpawnParams spawnParams;
+	for (; ReplayCursor < ReplayRecords.Num() && ReplayRecords[ReplayCursor].Frame <= replayFrame; ++ReplayCursor)
+	{
+		const FProjectileSpawnRecord& record = ReplayRecords[ReplayCursor];
+
+		spawnParams.TypeId = record.TypeId;
+		spawnParams.Transform = FTransform(
+			FQuat(FQuat4f(record.Rotation[0], record.Rotation[1], record.Rotation[2], record.Rotation[3])),
+			FVector(record.Location[0], record.Location[1], record.Location[2]));
+		spawnParams.Velocity = FVector(record.Velocity[0], record.Velocity[1], record.Velocity[2]);
+
+		UMassHelpers::SpawnProjectile(world, spawnParams);
+	}
+
+	if (ReplayCursor >= ReplayRecords.Num())
+	{
+		UE_LOG(LogLightweightProjectiles, Log, TEXT("Finished replaying projectile spawns after %u frames"), replayFrame);
+		StopReplay();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileRecordStartCmd(
+	TEXT("Projectiles.Record.Start"),
+	TEXT("Starts recording projectile spawns. Optional arg: output filename"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if (UProjectileSpawnRecorderSubsystem* recorder = UWorld::GetSubsystem<UProjectileSpawnRecorderSubsystem>(world))
+		{
+			recorder->StartRecording(args.Num() > 0 ? args[0] : FString());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileRecordStopCmd(
+	TEXT("Projectiles.Record.Stop"),
+	TEXT("Stops recording projectile spawns"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if (UProjectileSpawnRecorderSubsystem* recorder = UWorld::GetSubsystem<UProjectileSpawnRecorderSubsystem>(world))
+		{
+			recorder->StopRecording();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileReplayStartCmd(
+	TEXT("Projectiles.Replay.Start"),
+	TEXT("Replays a projectile spawn recording into the current world. Arg: recording filename"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		UProjectileSpawnRecorderSubsystem* recorder = UWorld::GetSubsystem<UProjectileSpawnRecorderSubsystem>(world);
+		if (recorder && args.Num() > 0)
+		{
+			recorder->StartReplay(args[0]);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileReplayStopCmd(
+	TEXT("Projectiles.Replay.Stop"),
+	TEXT("Stops the running projectile spawn replay"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if (UProjectileSpawnRecorderSubsystem* recorder = UWorld::GetSubsystem<UProjectileSpawnRecorderSubsystem>(world))
+		{
+			recorder->StopReplay();
+		}
+	}));
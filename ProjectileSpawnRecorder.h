@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileSpawnRecorder.generated.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+struct FProjectileSpawnParams;
+
+// On-disk layout, the file is a header followed by tightly packed records in spawn order
+struct FProjectileSpawnRecordFileHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x50535052; // 'PSPR'
+	static constexpr uint32 CurrentVersion = 2;
+
+	uint32 Magic = ExpectedMagic;
+	uint32 Version = CurrentVersion;
+	uint32 RecordSize = 0;
+	uint32 NumCatalogTypes = 0;
+};
+
+struct FProjectileSpawnRecord
+{
+	uint32 Frame = 0; // Relative to the start of the recording
+	uint16 TypeId = 0;
+	uint16 Padding = 0;
+	double Location[3] = {};
+	float Rotation[4] = {};
+	float Velocity[3] = {};
+	uint32 Reserved = 0;
+};
+static_assert(sizeof(FProjectileSpawnRecord) == 64, "Projectile spawn records are read straight out of a mapped file, bump the version if this changes");
+
+/**
+ * Captures every projectile spawned through UMassHelpers into an append-only binary file,
+ * and plays such a file back into the world at the frames the spawns originally happened on
+ */
+UCLASS()
+class LYRAGAME_API UProjectileSpawnRecorderSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float deltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	bool StartRecording(const FString& filename);
+	void StopRecording();
+	bool IsRecording() const { return RecordWriter.IsValid(); }
+
+	bool StartReplay(const FString& filename);
+	void StopReplay();
+	bool IsReplaying() const { return MappedRegion.IsValid(); }
+
+	// Spawn state is fully known, written immediately
+	void RecordSpawn(const FProjectileSpawnParams& spawnParams);
+	// Spawn state is filled in by the caller afterwards, snapshotted when the next Mass PrePhysics phase starts, before anything has moved
+	void RecordSpawnDeferred(FMassEntityHandle entity, uint16 typeId);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type worldType) const override;
+
+	void FlushDeferredRecords();
+	void OnPrePhysicsPhaseStarted(float deltaSeconds);
+	void WriteRecord(const FProjectileSpawnRecord& record);
+	void TickReplay();
+
+	uint32 GetRecordingFrame() const;
+
+	// Recording
+	TUniquePtr<FArchive> RecordWriter;
+	uint64 RecordStartFrame = 0;
+	int32 NumRecorded = 0;
+	FDelegateHandle PhaseStartedHandle;
+
+	struct FDeferredRecord
+	{
+		FMassEntityHandle Entity;
+		uint16 TypeId;
+		uint32 Frame;
+	};
+	TArray<FDeferredRecord> DeferredRecords;
+
+	// Replay
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TConstArrayView<FProjectileSpawnRecord> ReplayRecords;
+	int32 ReplayCursor = 0;
+	uint64 ReplayStartFrame = 0;
+};
@@ -0,0 +1,3 @@
+#include "Mass/ProjectileStats.h"
+
+DEFINE_LOG_CATEGORY(LogLightweightProjectiles);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "Logging/LogMacros.h"
+#include "Stats/Stats.h"
+
+LYRAGAME_API DECLARE_LOG_CATEGORY_EXTERN(LogLightweightProjectiles, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("Lightweight Projectiles"), STATGROUP_LightweightProjectiles, STATCAT_Advanced);
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileStreamingProcessor.h"
+#include "MassCommandBuffer.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "Mass/ProjectileFragments.h"
+#include "Mass/ProjectileMovementProcessor.h"
+#include "Mass/ProjectileStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Put To Sleep"), STAT_ProjectileStreaming_Slept, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Woken"), STAT_ProjectileStreaming_Woken, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Destroyed Unloaded"), STAT_ProjectileStreaming_Destroyed, STATGROUP_LightweightProjectiles);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Slept Too Long"), STAT_ProjectileStreaming_Expired, STATGROUP_LightweightProjectiles);
+
+UProjectileStreamingProcessor::UProjectileStreamingProcessor()
+{
+	ExecutionFlags = (int32)EProcessorExecutionFlags::All;
+
+	ExecutionOrder.ExecuteBefore.Add(UProjectileMovementProcessor::StaticClass()->GetFName());
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Movement;
+
+	// World partition streaming queries
+	bRequiresGameThreadExecution = true;
+}
+
+void UProjectileStreamingProcessor::Initialize(UObject& owner)
+{
+	Super::Initialize(owner);
+
+	StreamingSubsystem = UWorld::GetSubsystem<UProjectileStreamingSubsystem>(owner.GetWorld());
+}
+
+void UProjectileStreamingProcessor::ConfigureQueries()
+{
+	for (FMassEntityQuery* query : { &ActiveQuery, &DormantQuery })
+	{
+		// Whichever state layout the archetype uses
+		query->AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+		query->AddRequirement<FProjectileStateFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+		query->AddRequirement<FProjectileRelativeStateFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+		query->AddConstSharedRequirement<FProjectileStreamingPolicyFragment>(EMassFragmentPresence::All);
+	}
+	ActiveQuery.AddTagRequirement<FProjectileDormantTag>(EMassFragmentPresence::None);
+	ActiveQuery.AddRequirement<FProjectileDormantTimeFragment>(EMassFragmentAccess::ReadWrite, EMassFragmentPresence::Optional);
+	DormantQuery.AddTagRequirement<FProjectileDormantTag>(EMassFragmentPresence::All);
+	DormantQuery.AddRequirement<FProjectileDormantTimeFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+
+	ActiveQuery.RegisterWithProcessor(*this);
+	DormantQuery.RegisterWithProcessor(*this);
+}
+
+void UProjectileStreamingProcessor::Execute(FMassEntityManager& entityManager, FMassExecutionContext& context)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileStreamingProcessor_Execute);
+
+	if (!StreamingSubsystem || !StreamingSubsystem->IsStreamingAware())
+	{
+		return;
+	}
+
+	// Projectiles in a chunk are usually close together, so most lookups hit the previous entity's cell
+	auto forEachEntityCell = [this](FMassExecutionContext& context, auto&& func)
+	{
+		TConstArrayView<FTransformFragment> transforms = context.GetFragmentView<FTransformFragment>();
+		TConstArrayView<FProjectileStateFragment> states = context.GetFragmentView<FProjectileStateFragment>();
+		TConstArrayView<FProjectileRelativeStateFragment> relativeStates = context.GetFragmentView<FProjectileRelativeStateFragment>();
+
+		FIntVector lastCellKey(MAX_int32);
+		bool bLastCellLoaded = true;
+		for (int32 idx = 0; idx < context.GetNumEntities(); ++idx)
+		{
+			const FVector location = transforms.Num() > 0 ? transforms[idx].GetTransform().GetTranslation()
+				: states.Num() > 0 ? states[idx].GetPosition()
+				: relativeStates[idx].GetPosition();
+
+			const FIntVector cellKey = StreamingSubsystem->GetCellKey(location);
+			if (cellKey != lastCellKey)
+			{
+				lastCellKey = cellKey;
+				bLastCellLoaded = StreamingSubsystem->IsCellLoaded(cellKey);
+			}
+			func(idx, bLastCellLoaded);
+		}
+	};
+
+	const float now = context.GetWorld()->GetTimeSeconds();
+	EntitiesToDestroy.Reset();
+
+	// Every sleeper is rechecked at once when something streams in, rather than polling their cells every frame.
+	// Only the sleep timer is checked every frame, and only for types that have one
+	const bool bWakeRequested = StreamingSubsystem->ConsumeWakeRequest();
+	int32 numWoken = 0;
+	DormantQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		const float maxDormantTime = context.GetConstSharedFragment<FProjectileStreamingPolicyFragment>().MaxDormantTime;
+		TConstArrayView<FProjectileDormantTimeFragment> dormantTimes = context.GetFragmentView<FProjectileDormantTimeFragment>();
+		const bool bCanExpire = maxDormantTime > 0.f && dormantTimes.Num() > 0;
+		auto hasExpired = [&](int32 idx) { return bCanExpire && now - dormantTimes[idx].DormantSince > maxDormantTime; };
+
+		if (bWakeRequested)
+		{
+			forEachEntityCell(context, [&](int32 idx, bool bLoaded)
+			{
+				if (bLoaded)
+				{
+					context.Defer().RemoveTag<FProjectileDormantTag>(context.GetEntity(idx));
+					++numWoken;
+				}
+				else if (hasExpired(idx))
+				{
+					EntitiesToDestroy.Add(context.GetEntity(idx));
+				}
+			});
+		}
+		else if (bCanExpire)
+		{
+			for (int32 idx = 0; idx < context.GetNumEntities(); ++idx)
+			{
+				if (hasExpired(idx))
+				{
+					EntitiesToDestroy.Add(context.GetEntity(idx));
+				}
+			}
+		}
+	});
+	const int32 numExpired = EntitiesToDestroy.Num();
+	INC_DWORD_STAT_BY(STAT_ProjectileStreaming_Woken, numWoken);
+	INC_DWORD_STAT_BY(STAT_ProjectileStreaming_Expired, numExpired);
+
+	int32 numSlept = 0;
+	ActiveQuery.ForEachEntityChunk(entityManager, context, [&](FMassExecutionContext& context) {
+		const EProjectileUnloadedRegionPolicy policy = context.GetConstSharedFragment<FProjectileStreamingPolicyFragment>().UnloadedRegionPolicy;
+		if (policy == EProjectileUnloadedRegionPolicy::Simulate)
+		{
+			return;
+		}
+
+		TArrayView<FProjectileDormantTimeFragment> dormantTimes = context.GetMutableFragmentView<FProjectileDormantTimeFragment>();
+		forEachEntityCell(context, [&](int32 idx, bool bLoaded)
+		{
+			if (bLoaded)
+			{
+				return;
+			}
+			if (policy == EProjectileUnloadedRegionPolicy::Destroy)
+			{
+				EntitiesToDestroy.Add(context.GetEntity(idx));
+			}
+			else
+			{
+				if (dormantTimes.Num() > 0)
+				{
+					dormantTimes[idx].DormantSince = now;
+				}
+				context.Defer().AddTag<FProjectileDormantTag>(context.GetEntity(idx));
+				++numSlept;
+			}
+		});
+	});
+
+	INC_DWORD_STAT_BY(STAT_ProjectileStreaming_Slept, numSlept);
+	INC_DWORD_STAT_BY(STAT_ProjectileStreaming_Destroyed, EntitiesToDestroy.Num() - numExpired);
+	entityManager.Defer().DestroyEntities(EntitiesToDestroy);
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "Mass/ProjectileStreamingSubsystem.h"
+#include "ProjectileStreamingProcessor.generated.h"
+
+/**
+ * Applies FProjectileStreamingPolicyFragment before movement runs: projectiles in regions that aren't streamed in
+ * are put to sleep or destroyed, and sleeping ones are woken together once a level is added to the world
+ * or destroyed once they've slept longer than the policy's MaxDormantTime
+ */
+UCLASS()
+class LYRAGAME_API UProjectileStreamingProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UProjectileStreamingProcessor();
+
+protected:
+	virtual void Initialize(UObject& owner) override;
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& entityManager, FMassExecutionContext& context) override;
+
+	FMassEntityQuery ActiveQuery;
+	FMassEntityQuery DormantQuery;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileStreamingSubsystem> StreamingSubsystem;
+
+	// Kept around to avoid reallocating every frame
+	TArray<FMassEntityHandle> EntitiesToDestroy;
+};
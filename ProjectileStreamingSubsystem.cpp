@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileStreamingSubsystem.h"
+#include "Engine/World.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+namespace ProjectileStreaming
+{
+	static float CellSize = 12800.f;
+	static FAutoConsoleVariableRef CVarCellSize(TEXT("Projectiles.Streaming.CellSize"), CellSize, TEXT("Size of the grid cells streaming state is checked and cached for, in cm"));
+}
+
+void UProjectileStreamingSubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UProjectileStreamingSubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UProjectileStreamingSubsystem::OnLevelRemoved);
+}
+
+void UProjectileStreamingSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	CellLoaded.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UProjectileStreamingSubsystem::DoesSupportWorldType(EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
+
+bool UProjectileStreamingSubsystem::IsStreamingAware() const
+{
+	const UWorldPartition* worldPartition = GetWorld()->GetWorldPartition();
+	return worldPartition != nullptr && worldPartition->IsStreamingEnabled();
+}
+
+FIntVector UProjectileStreamingSubsystem::GetCellKey(const FVector& location) const
+{
+	const double cellSize = FMath::Max(ProjectileStreaming::CellSize, 100.f);
+	return FIntVector(
+		FMath::FloorToInt32(location.X / cellSize),
+		FMath::FloorToInt32(location.Y / cellSize),
+		FMath::FloorToInt32(location.Z / cellSize));
+}
+
+bool UProjectileStreamingSubsystem::IsCellLoaded(const FIntVector& cellKey)
+{
+	check(IsInGameThread());
+
+	if (const bool* bLoaded = CellLoaded.Find(cellKey))
+	{
+		return *bLoaded;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileStreamingSubsystem_QueryCell);
+
+	const UWorldPartitionSubsystem* worldPartitionSS = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>();
+	if (worldPartitionSS == nullptr)
+	{
+		return true;
+	}
+
+	// Sphere around the whole cell, a partly loaded cell counts as unloaded
+	const float cellSize = FMath::Max(ProjectileStreaming::CellSize, 100.f);
+	FWorldPartitionStreamingQuerySource querySource;
+	querySource.Location = (FVector(cellKey) + 0.5) * cellSize;
+	querySource.Radius = cellSize * UE_HALF_SQRT_3;
+	querySource.bSpatialQuery = true;
+	querySource.bUseGridLoadingRange = false;
+
+	// Activated rather than loaded, cells only have collision once they're added to the world
+	const bool bLoaded = worldPartitionSS->IsStreamingCompleted(EWorldPartitionRuntimeCellState::Activated, { querySource }, false);
+	CellLoaded.Add(cellKey, bLoaded);
+	return bLoaded;
+}
+
+bool UProjectileStreamingSubsystem::ConsumeWakeRequest()
+{
+	const bool bWake = bWakeRequested;
+	bWakeRequested = false;
+	return bWake;
+}
+
+void UProjectileStreamingSubsystem::OnLevelAdded(ULevel* level, UWorld* world)
+{
+	if (world == GetWorld())
+	{
+		CellLoaded.Reset();
+		bWakeRequested = true;
+	}
+}
+
+void UProjectileStreamingSubsystem::OnLevelRemoved(ULevel* level, UWorld* world)
+{
+	if (world == GetWorld())
+	{
+		CellLoaded.Reset();
+	}
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileStreamingSubsystem.generated.h"
+
+class ULevel;
+
+/**
+ * Answers whether a region of a world partition world is streamed in, cached per grid cell until the next level is added or removed.
+ * UProjectileStreamingProcessor uses it to put projectiles in unloaded regions to sleep and wake them when the region loads
+ */
+UCLASS()
+class LYRAGAME_API UProjectileStreamingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+	virtual void Deinitialize() override;
+
+	// Without world partition there is nothing to check, every region counts as loaded
+	bool IsStreamingAware() const;
+
+	FIntVector GetCellKey(const FVector& location) const;
+	// Game thread only
+	bool IsCellLoaded(const FIntVector& cellKey);
+
+	// True once after any level has been added to the world since the last call
+	bool ConsumeWakeRequest();
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type worldType) const override;
+
+	void OnLevelAdded(ULevel* level, UWorld* world);
+	void OnLevelRemoved(ULevel* level, UWorld* world);
+
+	TMap<FIntVector, bool> CellLoaded;
+	bool bWakeRequested = false;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
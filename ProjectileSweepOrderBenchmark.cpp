@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CollisionQueryParams.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Mass/ProjectileMovementKernel.h"
+#include "Mass/ProjectileStats.h"
+
+namespace ProjectileSweepOrderBenchmark
+{
+	struct FSweep
+	{
+		FVector Start;
+		FVector End;
+	};
+
+	static double RunSweeps(UWorld* world, TConstArrayView<FSweep> sweeps, TConstArrayView<int32> order, int32& outNumHits)
+	{
+		FCollisionQueryParams params;
+		params.bReturnPhysicalMaterial = true;
+		const FCollisionShape sweepShape = FCollisionShape::MakeSphere(1.f);
+
+		outNumHits = 0;
+		FHitResult hit;
+
+		const double startTime = FPlatformTime::Seconds();
+		for (const int32 sweepIdx : order)
+		{
+			if (world->SweepSingleByChannel(hit, sweeps[sweepIdx].Start, sweeps[sweepIdx].End, FQuat::Identity, ECC_Camera, sweepShape, params))
+			{
+				++outNumHits;
+			}
+		}
+		return FPlatformTime::Seconds() - startTime;
+	}
+
+	// Projectiles(ish) scattered around the local player, swept in spawn (random) order and then in Morton order
+	static void Run(const TArray<FString>& args, UWorld* world)
+	{
+		const int32 numSweeps = args.Num() > 0 ? FCString::Atoi(*args[0]) : 10000;
+		const double extent = args.Num() > 1 ? FCString::Atod(*args[1]) : 20000.0;
+		const double segmentLength = args.Num() > 2 ? FCString::Atod(*args[2]) : 1500.0;
+		const float cellSize = FMath::Max(args.Num() > 3 ? FCString::Atof(*args[3]) : 500.f, 1.f);
+		constexpr int32 numRepeats = 5;
+
+		FVector centre = FVector::ZeroVector;
+		if (const APlayerController* pc = world->GetFirstPlayerController())
+		{
+			if (const APawn* pawn = pc->GetPawn())
+			{
+				centre = pawn->GetActorLocation();
+			}
+		}
+
+		FRandomStream random(0x5eed);
+		TArray<FSweep> sweeps;
+		TArray<FVector> starts;
+		sweeps.Reserve(numSweeps);
+		starts.Reserve(numSweeps);
+		for (int32 idx = 0; idx < numSweeps; ++idx)
+		{
+			const FVector start = centre + FVector(random.FRandRange(-extent, extent), random.FRandRange(-extent, extent), random.FRandRange(-extent * 0.1, extent * 0.1));
+			sweeps.Add({ start, start + random.GetUnitVector() * segmentLength });
+			starts.Add(start);
+		}
+
+		TArray<int32> spawnOrder;
+		spawnOrder.SetNumUninitialized(numSweeps);
+		for (int32 idx = 0; idx < numSweeps; ++idx)
+		{
+			spawnOrder[idx] = idx;
+		}
+
+		const double sortStart = FPlatformTime::Seconds();
+		TArray<int32> mortonOrder;
+		UE::Projectiles::Kernel::SortByMortonKey(starts, cellSize, mortonOrder);
+		const double sortTime = FPlatformTime::Seconds() - sortStart;
+
+		// Interleave runs so neither order gets a consistently warmer cache
+		double spawnOrderTime = 0.0;
+		double mortonOrderTime = 0.0;
+		int32 spawnOrderHits = 0;
+		int32 mortonOrderHits = 0;
+		for (int32 repeat = 0; repeat < numRepeats; ++repeat)
+		{
+			spawnOrderTime += RunSweeps(world, sweeps, spawnOrder, spawnOrderHits);
+			mortonOrderTime += RunSweeps(world, sweeps, mortonOrder, mortonOrderHits);
+		}
+		spawnOrderTime /= numRepeats;
+		mortonOrderTime /= numRepeats;
+
+		UE_LOG(LogLightweightProjectiles, Display, TEXT("Sweep order benchmark: %d sweeps of %.0fcm within %.0fcm of %s"), numSweeps, segmentLength, extent, *centre.ToString());
+		UE_LOG(LogLightweightProjectiles, Display, TEXT("  Spawn order:  %.3fms (%.1fns/sweep, %d hits)"), spawnOrderTime * 1000.0, spawnOrderTime * 1e9 / FMath::Max(numSweeps, 1), spawnOrderHits);
+		UE_LOG(LogLightweightProjectiles, Display, TEXT("  Morton order: %.3fms (%.1fns/sweep, %d hits) + %.3fms sort at %.0fcm cells"), mortonOrderTime * 1000.0, mortonOrderTime * 1e9 / FMath::Max(numSweeps, 1), mortonOrderHits, sortTime * 1000.0, cellSize);
+		UE_LOG(LogLightweightProjectiles, Display, TEXT("  Speedup: %.2fx"), mortonOrderTime > 0.0 ? spawnOrderTime / mortonOrderTime : 0.0);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileSweepOrderBenchmarkCmd(
+	TEXT("Projectiles.Bench.SweepOrder"),
+	TEXT("Times projectile-like sweeps in spawn order against Morton order. Args: [NumSweeps=10000] [Extent=20000] [SegmentLength=1500] [CellSize=500]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ProjectileSweepOrderBenchmark::Run));
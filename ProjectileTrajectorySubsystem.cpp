@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/ProjectileTrajectorySubsystem.h"
+#include "Async/ParallelFor.h"
+#include "CollisionQueryParams.h"
+#include "Engine/World.h"
+#include "MassEntityConfigAsset.h"
+#include "Mass/LightweightProjectileTrait.h"
+#include "Mass/ProjectileMovementKernel.h"
+
+namespace ProjectileTrajectory
+{
+	static int32 MinLaunchesPerTask = 8;
+	static FAutoConsoleVariableRef CVarMinLaunchesPerTask(TEXT("Projectiles.Trajectory.MinLaunchesPerTask"), MinLaunchesPerTask, TEXT("Smallest batch of launches worth handing to another worker"));
+
+	// Built once per request, every launch shares the ignore set
+	static FCollisionQueryParams MakeQueryParams(const FProjectilePredictionParams& params)
+	{
+		FCollisionQueryParams queryParams(SCENE_QUERY_STAT(ProjectileTrajectory), false);
+		queryParams.bReturnPhysicalMaterial = true;
+		for (AActor* actor : params.IgnoredActors)
+		{
+			if (IsValid(actor))
+			{
+				queryParams.AddIgnoredActor(actor);
+			}
+		}
+		return queryParams;
+	}
+}
+
+FProjectileBallistics::FProjectileBallistics(const UWorld& world, const ULightweightProjectileTrait& trait)
+	: ArchetypeDescription(trait.ProjectileArchetypeDescription)
+	, Gravity(0.f, 0.f, world.GetGravityZ() * trait.GravityScale)
+{
+	bHasDrag = trait.MakeDragFragment(Drag);
+}
+
+void UProjectileTrajectorySubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	// Predictions requested after this subsystem ticked complete once actors are done ticking, and the collection check covers
+	// anything requested after that
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UProjectileTrajectorySubsystem::OnWorldPostActorTick);
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UProjectileTrajectorySubsystem::CompletePendingPredictions);
+}
+
+void UProjectileTrajectorySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PostActorTickHandle.Reset();
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+	PreGarbageCollectHandle.Reset();
+
+	// Nothing is left to hear about these
+	for (FPendingPrediction& prediction : PendingPredictions)
+	{
+		prediction.Task.Wait();
+	}
+	PendingPredictions.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId UProjectileTrajectorySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileTrajectorySubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileTrajectorySubsystem::Tick(float deltaTime)
+{
+	Super::Tick(deltaTime);
+
+	CompletePendingPredictions();
+}
+
+void UProjectileTrajectorySubsystem::OnWorldPostActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if (world == GetWorld())
+	{
+		CompletePendingPredictions();
+	}
+}
+
+void UProjectileTrajectorySubsystem::CompletePendingPredictions()
+{
+	check(IsInGameThread());
+
+	if (PendingPredictions.Num() == 0)
+	{
+		return;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileTrajectory_CompletePendingPredictions);
+
+	// Callbacks are free to request more predictions, those wait for the next completion point
+	TArray<FPendingPrediction> predictions = MoveTemp(PendingPredictions);
+	PendingPredictions.Reset();
+	for (FPendingPrediction& prediction : predictions)
+	{
+		prediction.Task.Wait();
+		prediction.OnComplete(MoveTemp(prediction.Task.GetResult()));
+	}
+}
+
+void UProjectileTrajectorySubsystem::PredictPaths(const ULightweightProjectileTrait& trait, TConstArrayView<FProjectileLaunchState> launches, const FProjectilePredictionParams& params, TArray<FProjectilePredictedPath>& outPaths) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileTrajectory_PredictPaths);
+
+	const UWorld& world = *GetWorld();
+	PredictPathsInternal(world, FProjectileBallistics(world, trait), ProjectileTrajectory::MakeQueryParams(params), launches, params, outPaths);
+}
+
+void UProjectileTrajectorySubsystem::PredictPathsAsync(const ULightweightProjectileTrait& trait, TArray<FProjectileLaunchState> launches, const FProjectilePredictionParams& params, TFunction<void(TArray<FProjectilePredictedPath>&&)> onComplete)
+{
+	check(IsInGameThread());
+
+	// Only plain data crosses over, the world outlives the task since it's always finished before a collection or Deinitialize
+	const UWorld* world = GetWorld();
+	FPendingPrediction& prediction = PendingPredictions.AddDefaulted_GetRef();
+	prediction.OnComplete = MoveTemp(onComplete);
+	prediction.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[world, ballistics = FProjectileBallistics(*world, trait), queryParams = ProjectileTrajectory::MakeQueryParams(params), launches = MoveTemp(launches), params]()
+		{
+			QUICK_SCOPE_CYCLE_COUNTER(STAT_ProjectileTrajectory_PredictPathsAsync);
+
+			TArray<FProjectilePredictedPath> paths;
+			PredictPathsInternal(*world, ballistics, queryParams, launches, params, paths);
+			return paths;
+		});
+}
+
+void UProjectileTrajectorySubsystem::PredictPath(const UWorld& world, const FProjectileArchetypeDescription& archetypeDescription, const FCollisionQueryParams& queryParams, const FVector& gravity, const FProjectileDragFragment* drag,
+	const FProjectileLaunchState& launch, float maxFlightTime, float stepTime, bool bRecordPath, FProjectilePredictedPath& outPath)
+{
+	outPath.Points.Reset();
+	outPath.bHit = false;
+
+	const FCollisionShape sweepShape = FCollisionShape::MakeSphere(archetypeDescription.SweepRadius);
+	FVector position = launch.Location;
+	FVector velocity = launch.Velocity;
+	double flightTime = 0.0;
+	if (bRecordPath)
+	{
+		outPath.Points.Reserve(FMath::CeilToInt32(maxFlightTime / stepTime) + 1);
+		outPath.Points.Add(position);
+	}
+
+	// Integrate then sweep along the new velocity, the same order UProjectileMovementProcessor uses
+	while (flightTime < maxFlightTime)
+	{
+		const float deltaTime = FMath::Min(stepTime, maxFlightTime - static_cast<float>(flightTime));
+		UE::Projectiles::Kernel::IntegrateVelocityReference(velocity, FVector::ZeroVector, gravity, drag, deltaTime);
+
+		const FVector endPos = position + velocity * deltaTime;
+		if (world.SweepSingleByChannel(outPath.Hit, position, endPos, FQuat::Identity, archetypeDescription.CollisionChannel, sweepShape, queryParams))
+		{
+			outPath.bHit = true;
+			flightTime += deltaTime * outPath.Hit.Time;
+			position = outPath.Hit.Location;
+		}
+		else
+		{
+			flightTime += deltaTime;
+			position = endPos;
+		}
+
+		if (bRecordPath)
+		{
+			outPath.Points.Add(position);
+		}
+		if (outPath.bHit)
+		{
+			break;
+		}
+	}
+
+	outPath.FlightTime = static_cast<float>(flightTime);
+	outPath.EndVelocity = velocity;
+}
+
+void UProjectileTrajectorySubsystem::PredictPathsInternal(const UWorld& world, const FProjectileBallistics& ballistics, const FCollisionQueryParams& queryParams,
+	TConstArrayView<FProjectileLaunchState> launches, const FProjectilePredictionParams& params, TArray<FProjectilePredictedPath>& outPaths)
+{
+	outPaths.SetNum(launches.Num());
+
+	const float stepTime = FMath::Max(params.StepTime, 0.001f);
+	const int32 numLaunches = launches.Num();
+	const int32 numTasks = FMath::Max(1, numLaunches / FMath::Max(ProjectileTrajectory::MinLaunchesPerTask, 1));
+	const int32 launchesPerTask = FMath::DivideAndRoundUp(numLaunches, numTasks);
+
+	ParallelFor(numTasks, [&](int32 taskIdx)
+	{
+		const int32 firstLaunch = taskIdx * launchesPerTask;
+		const int32 lastLaunch = FMath::Min(firstLaunch + launchesPerTask, numLaunches);
+		for (int32 launchIdx = firstLaunch; launchIdx < lastLaunch; ++launchIdx)
+		{
+			PredictPath(world, ballistics.ArchetypeDescription, queryParams, ballistics.Gravity, ballistics.GetDrag(), launches[launchIdx], params.MaxFlightTime, stepTime, params.bRecordPath, outPaths[launchIdx]);
+		}
+	}, numTasks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void UProjectileTrajectorySubsystem::BP_PredictPaths(UMassEntityConfigAsset* massEntityConfig, const TArray<FProjectileLaunchState>& launches, const FProjectilePredictionParams& params, TArray<FProjectilePredictedPath>& outPaths) const
+{
+	outPaths.Reset();
+	if (const ULightweightProjectileTrait* trait = FindTrait(massEntityConfig))
+	{
+		PredictPaths(*trait, launches, params, outPaths);
+	}
+}
+
+void UProjectileTrajectorySubsystem::BP_PredictPathsAsync(UMassEntityConfigAsset* massEntityConfig, const TArray<FProjectileLaunchState>& launches, const FProjectilePredictionParams& params, FOnProjectilePathsPredicted onComplete)
+{
+	const ULightweightProjectileTrait* trait = FindTrait(massEntityConfig);
+	if (trait == nullptr)
+	{
+		onComplete.ExecuteIfBound(TArray<FProjectilePredictedPath>());
+		return;
+	}
+
+	PredictPathsAsync(*trait, launches, params, [onComplete](TArray<FProjectilePredictedPath>&& paths)
+	{
+		onComplete.ExecuteIfBound(paths);
+	});
+}
+
+const ULightweightProjectileTrait* UProjectileTrajectorySubsystem::FindTrait(const UMassEntityConfigAsset* massEntityConfig)
+{
+	if (!IsValid(massEntityConfig))
+	{
+		return nullptr;
+	}
+	return Cast<ULightweightProjectileTrait>(massEntityConfig->GetConfig().FindTrait(ULightweightProjectileTrait::StaticClass()));
+}
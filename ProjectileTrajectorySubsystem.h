@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/HitResult.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "Mass/ProjectileFragments.h"
+#include "ProjectileTrajectorySubsystem.generated.h"
+
+struct FCollisionQueryParams;
+class ULightweightProjectileTrait;
+class UMassEntityConfigAsset;
+
+USTRUCT(BlueprintType)
+struct FProjectileLaunchState
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Velocity = FVector::ZeroVector;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectilePredictionParams
+{
+	GENERATED_BODY()
+
+	// Paths that haven't hit anything by then are cut off
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float MaxFlightTime = 3.f;
+
+	// The movement processor steps once per frame, predictions match it exactly when this matches the frame time
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.001"))
+	float StepTime = 1.f / 30.f;
+
+	// Skip the sampled points when only the impact is wanted
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bRecordPath = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<TObjectPtr<AActor>> IgnoredActors;
+};
+
+USTRUCT(BlueprintType)
+struct FProjectilePredictedPath
+{
+	GENERATED_BODY()
+
+	// Launch location, then the end of each step, ending at the impact if there was one
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FVector> Points;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bHit = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	FHitResult Hit;
+
+	// Time to the impact, or the whole flight time when nothing was hit
+	UPROPERTY(BlueprintReadOnly)
+	float FlightTime = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector EndVelocity = FVector::ZeroVector;
+};
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnProjectilePathsPredicted, const TArray<FProjectilePredictedPath>&, paths);
+
+// Everything the prediction needs from a projectile type, copied out so it can run without touching the trait
+struct FProjectileBallistics
+{
+	FProjectileArchetypeDescription ArchetypeDescription;
+	FVector Gravity = FVector::ZeroVector;
+	FProjectileDragFragment Drag;
+	bool bHasDrag = false;
+
+	FProjectileBallistics() = default;
+	FProjectileBallistics(const UWorld& world, const ULightweightProjectileTrait& trait);
+
+	const FProjectileDragFragment* GetDrag() const { return bHasDrag ? &Drag : nullptr; }
+};
+
+/**
+ * Predicts projectile paths with the same integration and sweeps UProjectileMovementProcessor uses,
+ * for aim assist, AI firing solutions and arc previews. Launches are spread over worker threads
+ */
+UCLASS()
+class LYRAGAME_API UProjectileTrajectorySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float deltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void PredictPaths(const ULightweightProjectileTrait& trait, TConstArrayView<FProjectileLaunchState> launches, const FProjectilePredictionParams& params, TArray<FProjectilePredictedPath>& outPaths) const;
+	// Runs on the task graph alongside the rest of the frame, onComplete is called on the game thread once actors have ticked,
+	// so a request made during actor ticks completes the same frame. Anything requested later waits for the next tick, but never
+	// outlives a garbage collection or the world
+	void PredictPathsAsync(const ULightweightProjectileTrait& trait, TArray<FProjectileLaunchState> launches, const FProjectilePredictionParams& params, TFunction<void(TArray<FProjectilePredictedPath>&&)> onComplete);
+
+	// Single path, shared with the hitscan path in UMassHelpers::SpawnProjectile
+	static void PredictPath(const UWorld& world, const FProjectileArchetypeDescription& archetypeDescription, const FCollisionQueryParams& queryParams, const FVector& gravity, const FProjectileDragFragment* drag,
+		const FProjectileLaunchState& launch, float maxFlightTime, float stepTime, bool bRecordPath, FProjectilePredictedPath& outPath);
+
+	// Uses the config's ULightweightProjectileTrait, returns nothing if it doesn't have one
+	UFUNCTION(BlueprintCallable, Category = "Projectile Trajectory", meta = (DisplayName = "Predict Projectile Paths"))
+	void BP_PredictPaths(UMassEntityConfigAsset* massEntityConfig, const TArray<FProjectileLaunchState>& launches, const FProjectilePredictionParams& params, TArray<FProjectilePredictedPath>& outPaths) const;
+	UFUNCTION(BlueprintCallable, Category = "Projectile Trajectory", meta = (DisplayName = "Predict Projectile Paths (async)"))
+	void BP_PredictPathsAsync(UMassEntityConfigAsset* massEntityConfig, const TArray<FProjectileLaunchState>& launches, const FProjectilePredictionParams& params, FOnProjectilePathsPredicted onComplete);
+
+protected:
+	static const ULightweightProjectileTrait* FindTrait(const UMassEntityConfigAsset* massEntityConfig);
+	static void PredictPathsInternal(const UWorld& world, const FProjectileBallistics& ballistics, const FCollisionQueryParams& queryParams,
+		TConstArrayView<FProjectileLaunchState> launches, const FProjectilePredictionParams& params, TArray<FProjectilePredictedPath>& outPaths);
+
+	void CompletePendingPredictions();
+	void OnWorldPostActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds);
+
+	struct FPendingPrediction
+	{
+		UE::Tasks::TTask<TArray<FProjectilePredictedPath>> Task;
+		TFunction<void(TArray<FProjectilePredictedPath>&&)> OnComplete;
+	};
+
+	// They sweep against the world, so are finished every tick, after actor ticks and before garbage collection or the world going away
+	TArray<FPendingPrediction> PendingPredictions;
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle PostActorTickHandle;
+};